@@ -0,0 +1,77 @@
+#ifndef _allocator_
+#define _allocator_
+#include <stdlib.h>
+#include <string.h>
+
+/* File: allocator.h
+ * -----------------
+ * Defines the allocator, the interface through which vectors and
+ * hashsets acquire and release their memory.
+ *
+ * By default, both go straight to malloc, realloc, and free.  Clients
+ * can instead hand them an allocator that carves memory out of an arena
+ * (see ArenaAllocatorNew), a pool, or a per-thread cache, so that
+ * short-lived containers never touch the shared heap at all and can be
+ * released wholesale by releasing the memory behind them.
+ */
+
+/**
+ * Type: allocator
+ * ---------------
+ * A table of the three memory operations plus the context they
+ * operate on.  Each function is handed the context as its first argument.
+ * Release and reallocation are told the size of the block, so allocators
+ * that don't keep any bookkeeping of their own still have what they need.
+ *
+ *    - allocate must return size bytes of memory aligned for any of the
+ *      built-in types, or NULL if memory runs out.
+ *    - reallocate may be NULL, in which case resizing a block is done by
+ *      allocating a new block, copying, and releasing the old one.
+ *    - release may be NULL, in which case blocks are simply abandoned
+ *      (which is exactly right for an arena).
+ *
+ * An allocator is referred to, not copied, by the containers using it,
+ * so it needs to outlive all of them.
+ */
+
+typedef struct {
+  void *(*allocate)(void *context, size_t size);
+  void *(*reallocate)(void *context, void *addr, size_t oldSize, size_t newSize);
+  void (*release)(void *context, void *addr, size_t size);
+  void *context;
+} allocator;
+
+/**
+ * Functions: AllocatorAllocate, AllocatorReallocate, AllocatorRelease
+ * -------------------------------------------------------------------
+ * Route a request to the specified allocator, or to malloc, realloc, and
+ * free when the allocator is NULL.  They're defined right here so that
+ * the NULL case costs no more than calling malloc directly.
+ */
+
+static inline void *AllocatorAllocate(const allocator *a, size_t size)
+{
+  if (a == NULL) return malloc(size);
+  return a->allocate(a->context, size);
+}
+
+static inline void *AllocatorReallocate(const allocator *a, void *addr, size_t oldSize, size_t newSize)
+{
+  if (a == NULL) return realloc(addr, newSize);
+  if (a->reallocate != NULL) return a->reallocate(a->context, addr, oldSize, newSize);
+
+  void *resized = a->allocate(a->context, newSize);
+  if (resized != NULL && addr != NULL) {
+    memcpy(resized, addr, (oldSize < newSize) ? oldSize : newSize);
+    if (a->release != NULL) a->release(a->context, addr, oldSize);
+  }
+  return resized;
+}
+
+static inline void AllocatorRelease(const allocator *a, void *addr, size_t size)
+{
+  if (a == NULL) free(addr);
+  else if (a->release != NULL && addr != NULL) a->release(a->context, addr, size);
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include "bool.h"
+
+static const int kDefaultChunkSize = 64 * 1024;
+static const int kAlignment = 2 * sizeof(void *);
+
+/**
+ * Every chunk starts with a header that links it to the chunk created
+ * before it.  The header is padded out to kAlignment bytes so that the
+ * first allocation carved out of the chunk is properly aligned.
+ */
+
+typedef union {
+  void *previous;
+  char padding[2 * sizeof(void *)];
+} chunkHeader;
+
+static int RoundUp(int size, int alignment)
+{
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+static char *ChunkNew(arena *a, int size)
+{
+  chunkHeader *chunk = malloc(sizeof(chunkHeader) + size);
+  assert(chunk != NULL);
+  chunk->previous = a->chunks;
+  a->chunks = chunk;
+  a->numChunks++;
+  return (char *) (chunk + 1);
+}
+
+void ArenaNew(arena *a, int chunkSize)
+{
+  assert(chunkSize >= 0);
+  a->chunkSize = (chunkSize == 0) ? kDefaultChunkSize : RoundUp(chunkSize, kAlignment);
+  a->chunks = NULL;
+  a->next = a->end = NULL;
+  a->numChunks = 0;
+}
+
+void ArenaDispose(arena *a)
+{
+  while (a->chunks != NULL) {
+    chunkHeader *chunk = a->chunks;
+    a->chunks = chunk->previous;
+    free(chunk);
+  }
+}
+
+/**
+ * Carves size bytes, starting at a multiple of alignment, out of
+ * the chunk currently being carved up, moving on to a fresh chunk
+ * if the current one doesn't have enough room left.  Chunks themselves
+ * always begin on a kAlignment boundary.
+ */
+
+static void *Carve(arena *a, int size, int alignment)
+{
+  assert(size >= 0);
+  if (size > a->chunkSize / 4)
+    return ChunkNew(a, size); // the chunk being carved up stays current
+
+  char *start = a->next;
+  if (start != NULL)
+    start += (alignment - (unsigned long) start % alignment) % alignment;
+  if (start == NULL || a->end - start < size) {
+    start = ChunkNew(a, a->chunkSize);
+    a->end = start + a->chunkSize;
+  }
+
+  a->next = start + size;
+  return start;
+}
+
+void *ArenaAllocate(arena *a, int size)
+{
+  return Carve(a, size, kAlignment);
+}
+
+char *ArenaStrdup(arena *a, const char *s)
+{
+  assert(s != NULL);
+  int size = strlen(s) + 1;
+  char *copy = Carve(a, size, 1);
+  memcpy(copy, s, size);
+  return copy;
+}
+
+int ArenaNumChunks(const arena *a)
+{
+  return a->numChunks;
+}
+
+static void *AllocatorCarve(void *context, size_t size)
+{
+  assert(size <= INT_MAX);
+  return ArenaAllocate(context, size);
+}
+
+/**
+ * Grows or shrinks the block in place when it's the last thing carved
+ * out of the current chunk and the chunk has enough room; otherwise copies
+ * it into a fresh block and abandons the old one.
+ */
+
+static void *AllocatorRecarve(void *context, void *addr, size_t oldSize, size_t newSize)
+{
+  arena *a = context;
+  assert(newSize <= INT_MAX);
+  bool lastCarved = addr != NULL && (char *) addr >= a->end - a->chunkSize && (char *) addr + oldSize == a->next;
+  if (lastCarved && (size_t) (a->end - (char *) addr) >= newSize) {
+    a->next = (char *) addr + newSize;
+    return addr;
+  }
+
+  void *resized = ArenaAllocate(a, newSize);
+  if (addr != NULL) memcpy(resized, addr, (oldSize < newSize) ? oldSize : newSize);
+  return resized;
+}
+
+void ArenaAllocatorNew(allocator *alloc, arena *a)
+{
+  alloc->allocate = AllocatorCarve;
+  alloc->reallocate = AllocatorRecarve;
+  alloc->release = NULL;
+  alloc->context = a;
+}
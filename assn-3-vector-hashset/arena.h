@@ -0,0 +1,111 @@
+#ifndef _arena_
+#define _arena_
+#include "allocator.h"
+
+/* File: arena.h
+ * -------------
+ * Defines the interface for the arena, a bump-pointer allocator
+ * for objects that all live and die together.
+ *
+ * Memory is carved out of large chunks, one allocation after
+ * another, so an allocation costs little more than a pointer
+ * increment.  Nothing is ever freed individually; instead,
+ * ArenaDispose releases every chunk at once, no matter how many
+ * objects were allocated from them.
+ */
+
+/**
+ * Type: arena
+ * -----------
+ * The concrete representation of the arena.  In spite
+ * of all of the fields being publicly accessible, the
+ * client is absolutely required to initialize, inspect,
+ * and update the arena using only those functions
+ * defined below.
+ */
+
+typedef struct {
+  void *chunks;      // most recently created chunk; each one links to its predecessor
+  char *next;        // first unused byte of the chunk being carved up
+  char *end;         // one past the last byte of the chunk being carved up
+  int chunkSize;
+  int numChunks;
+} arena;
+
+/**
+ * Function: ArenaNew
+ * ------------------
+ * Initializes the identified arena so that it's ready to hand out memory.
+ * chunkSize is the number of bytes requested from malloc at a time.  A value
+ * of 0 is taken as a request for a sensible default (currently 64 KB).
+ * No memory is allocated until the first call to ArenaAllocate.
+ *
+ * An assert is raised if chunkSize is negative.
+ */
+
+void ArenaNew(arena *a, int chunkSize);
+
+/**
+ * Function: ArenaDispose
+ * ----------------------
+ * Releases every chunk acquired by the arena, and with them every
+ * object ever handed out by ArenaAllocate.  The cost depends only on
+ * the number of chunks, and not at all on the number of objects.
+ * The arena needs to be reinitialized with ArenaNew before it can be
+ * used again.
+ */
+
+void ArenaDispose(arena *a);
+
+/**
+ * Function: ArenaAllocate
+ * -----------------------
+ * Returns the address of size bytes of uninitialized memory, suitably
+ * aligned for any of the built-in types.  The memory remains valid until
+ * the arena is disposed of.  Requests bigger than a quarter of the
+ * chunk size get a chunk of their own, so they never waste the tail
+ * end of the chunk currently being carved up.
+ *
+ * An assert is raised if size is negative or if memory runs out.
+ */
+
+void *ArenaAllocate(arena *a, int size);
+
+/**
+ * Function: ArenaStrdup
+ * ---------------------
+ * Copies the specified C string into the arena and returns the address
+ * of the copy.  Strings need no alignment, so successive copies are packed
+ * end to end without any padding in between.
+ *
+ * An assert is raised if s is NULL.
+ */
+
+char *ArenaStrdup(arena *a, const char *s);
+
+/**
+ * Function: ArenaNumChunks
+ * ------------------------
+ * Returns the number of chunks the arena has acquired so far.
+ */
+
+int ArenaNumChunks(const arena *a);
+
+/**
+ * Function: ArenaAllocatorNew
+ * ---------------------------
+ * Initializes the identified allocator so that it carves memory out of the
+ * specified arena, which lets vectors and hashsets (see VectorNewUsingAllocator
+ * and HashSetNewUsingAllocator) live entirely inside the arena.  Releasing memory
+ * through the allocator does nothing, and growing the block most recently
+ * carved out of the arena happens in place whenever the chunk has room.
+ * Disposing of the arena reclaims everything in one go.  Containers living
+ * in it should still be disposed of first if their elements need freeing.
+ * They aren't counted by VectorGlobalStats or HashSetGlobalStats.
+ *
+ * Arenas aren't thread-safe, so every thread needs an arena of its own.
+ */
+
+void ArenaAllocatorNew(allocator *alloc, arena *a);
+
+#endif
@@ -0,0 +1,122 @@
+#include "concurrenthashset.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <limits.h>
+
+static const int kFullHashRange = INT_MAX;
+static const unsigned int kGoldenRatioMultiplier = 2654435761u;
+
+void ConcurrentHashSetNew(concurrenthashset *h, int elemSize, int numBuckets, int numShards,
+			  HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+			  HashSetFreeFunction freefn)
+{
+  assert(numBuckets > 0);
+  assert(numShards > 0);
+  assert(hashfn != NULL);
+
+  h->numShards = numShards;
+  h->count = 0;
+  h->hashFn = hashfn;
+  h->shards = malloc(numShards * sizeof(concurrenthashsetShard));
+  assert(h->shards != NULL);
+
+  int numBucketsPerShard = (numBuckets + numShards - 1) / numShards;
+  for (int i = 0; i < numShards; i++) {
+    pthread_mutex_init(&h->shards[i].lock, NULL);
+    HashSetNewCachingHashCodes(&h->shards[i].elements, elemSize, numBucketsPerShard,
+			       hashfn, comparefn, freefn, kHashSetChaining);
+  }
+}
+
+void ConcurrentHashSetDispose(concurrenthashset *h)
+{
+  for (int i = 0; i < h->numShards; i++) {
+    HashSetDispose(&h->shards[i].elements);
+    pthread_mutex_destroy(&h->shards[i].lock);
+  }
+  free(h->shards);
+}
+
+int ConcurrentHashSetCount(const concurrenthashset *h)
+{
+  return __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+}
+
+/**
+ * Picks the shard responsible for the specified element, and sets *hashCode
+ * to the element's full hash code.  The shards cache hash codes, so they're
+ * handed the same code rather than calling the hash function a second time.
+ * The code is scrambled before it's scaled down to a shard number; otherwise
+ * all of the elements in a shard would share the same few low-order bits,
+ * and they'd bunch up in the same few buckets of the shard's own hashset.
+ */
+
+static concurrenthashsetShard *ShardFor(const concurrenthashset *h, const void *elemAddr, int *hashCode)
+{
+  assert(elemAddr != NULL);
+  *hashCode = h->hashFn(elemAddr, kFullHashRange);
+  assert(*hashCode >= 0 && *hashCode < kFullHashRange);
+  unsigned int scrambled = (unsigned int) *hashCode * kGoldenRatioMultiplier;
+  return &h->shards[((unsigned long long) scrambled * h->numShards) >> 32];
+}
+
+void ConcurrentHashSetEnter(concurrenthashset *h, const void *elemAddr)
+{
+  int hashCode;
+  concurrenthashsetShard *shard = ShardFor(h, elemAddr, &hashCode);
+  pthread_mutex_lock(&shard->lock);
+  int countBefore = HashSetCount(&shard->elements);
+  HashSetEnterWithHashCode(&shard->elements, elemAddr, hashCode);
+  if (HashSetCount(&shard->elements) > countBefore)
+    __atomic_add_fetch(&h->count, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&shard->lock);
+}
+
+void *ConcurrentHashSetLookup(concurrenthashset *h, const void *elemAddr)
+{
+  int hashCode;
+  concurrenthashsetShard *shard = ShardFor(h, elemAddr, &hashCode);
+  pthread_mutex_lock(&shard->lock);
+  void *found = HashSetLookupWithHashCode(&shard->elements, elemAddr, hashCode);
+  pthread_mutex_unlock(&shard->lock);
+  return found;
+}
+
+bool ConcurrentHashSetFindOrInsert(concurrenthashset *h, const void *elemAddr,
+				   ConcurrentHashSetUpdateFunction updatefn, void *auxData)
+{
+  int hashCode;
+  concurrenthashsetShard *shard = ShardFor(h, elemAddr, &hashCode);
+  pthread_mutex_lock(&shard->lock);
+  bool inserted;
+  void *found = HashSetFindOrInsertWithHashCode(&shard->elements, elemAddr, hashCode, &inserted);
+  if (inserted)
+    __atomic_add_fetch(&h->count, 1, __ATOMIC_RELAXED);
+
+  if (updatefn != NULL)
+    updatefn(found, inserted, auxData);
+  pthread_mutex_unlock(&shard->lock);
+  return inserted;
+}
+
+bool ConcurrentHashSetRemove(concurrenthashset *h, const void *elemAddr)
+{
+  int hashCode;
+  concurrenthashsetShard *shard = ShardFor(h, elemAddr, &hashCode);
+  pthread_mutex_lock(&shard->lock);
+  bool removed = HashSetRemoveWithHashCode(&shard->elements, elemAddr, hashCode);
+  if (removed)
+    __atomic_sub_fetch(&h->count, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&shard->lock);
+  return removed;
+}
+
+void ConcurrentHashSetMap(concurrenthashset *h, HashSetMapFunction mapfn, void *auxData)
+{
+  assert(mapfn != NULL);
+  for (int i = 0; i < h->numShards; i++) {
+    pthread_mutex_lock(&h->shards[i].lock);
+    HashSetMap(&h->shards[i].elements, mapfn, auxData);
+    pthread_mutex_unlock(&h->shards[i].lock);
+  }
+}
@@ -0,0 +1,155 @@
+#ifndef _concurrenthashset_
+#define _concurrenthashset_
+#include "hashset.h"
+#include <pthread.h>
+
+/* File: concurrenthashset.h
+ * -------------------------
+ * Defines the interface for the concurrenthashset, a thread-safe
+ * version of the hashset.
+ *
+ * The elements are spread over a fixed number of shards, each of which
+ * is an ordinary hashset (one that caches hash codes, so each element is
+ * only ever hashed once) guarded by its own lock.  Two threads only
+ * contend with one another when they touch elements that happen to live
+ * in the same shard, so with enough shards, dozens of threads can enter
+ * elements at the same time.
+ */
+
+/**
+ * Type: ConcurrentHashSetUpdateFunction
+ * -------------------------------------
+ * Class of function handed to ConcurrentHashSetFindOrInsert.  It's called
+ * with the address of the stored element, a flag that's true if and only if
+ * the element was inserted by that very call, and the auxData pointer passed
+ * to ConcurrentHashSetFindOrInsert.  The function runs while the element's
+ * shard is locked, so it's free to update the element (but not to change
+ * how it hashes or compares).
+ */
+
+typedef void (*ConcurrentHashSetUpdateFunction)(void *elemAddr, bool inserted, void *auxData);
+
+/**
+ * Type: concurrenthashsetShard
+ * ----------------------------
+ * One lock and the hashset it protects.  Clients never
+ * deal with this type directly.
+ */
+
+typedef struct {
+  pthread_mutex_t lock;
+  hashset elements;
+} concurrenthashsetShard;
+
+/**
+ * Type: concurrenthashset
+ * -----------------------
+ * The concrete representation of the concurrenthashset.  As with
+ * the hashset, the fields are exposed, but clients should only
+ * interact with a concurrenthashset via the functions below.
+ */
+
+typedef struct {
+  int numShards;
+  concurrenthashsetShard *shards;
+  int count; // only ever read and written atomically
+  HashSetHashFunction hashFn;
+} concurrenthashset;
+
+/**
+ * Function: ConcurrentHashSetNew
+ * ------------------------------
+ * Initializes the identified concurrenthashset to be empty.  The elemSize,
+ * hashfn, comparefn, and freefn parameters mean exactly what they mean
+ * to HashSetNew.  numBuckets is the total number of buckets, and is divided
+ * up evenly among the numShards shards.  An element's shard is picked from
+ * the hash code the hashfn produces when it's told there are INT_MAX buckets,
+ * so the hashfn should spread its codes over that whole range.
+ *
+ * An assert is raised unless all of the following conditions are met:
+ *    - elemSize is greater than 0.
+ *    - numBuckets is greater than 0.
+ *    - numShards is greater than 0.
+ *    - hashfn is non-NULL
+ *    - comparefn is non-NULL
+ */
+
+void ConcurrentHashSetNew(concurrenthashset *h, int elemSize, int numBuckets, int numShards,
+			  HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+			  HashSetFreeFunction freefn);
+
+/**
+ * Function: ConcurrentHashSetDispose
+ * ----------------------------------
+ * Disposes of all the shards, levying the free function against every
+ * element, just as HashSetDispose does.  No other thread may be using
+ * the concurrenthashset while it's being disposed of.
+ */
+
+void ConcurrentHashSetDispose(concurrenthashset *h);
+
+/**
+ * Function: ConcurrentHashSetCount
+ * --------------------------------
+ * Returns the number of elements residing in the specified
+ * concurrenthashset.  Runs in constant time and never blocks,
+ * even while other threads are entering elements.
+ */
+
+int ConcurrentHashSetCount(const concurrenthashset *h);
+
+/**
+ * Function: ConcurrentHashSetEnter
+ * --------------------------------
+ * Thread-safe version of HashSetEnter.
+ */
+
+void ConcurrentHashSetEnter(concurrenthashset *h, const void *elemAddr);
+
+/**
+ * Function: ConcurrentHashSetLookup
+ * ---------------------------------
+ * Thread-safe version of HashSetLookup.  Understand that the address
+ * handed back is only good for as long as no other thread is entering
+ * elements, since a concurrent insertion into the same shard might move
+ * the element.  Clients that need to examine or update an element while
+ * other threads are still busy entering them should go through
+ * ConcurrentHashSetFindOrInsert instead.
+ */
+
+void *ConcurrentHashSetLookup(concurrenthashset *h, const void *elemAddr);
+
+/**
+ * Function: ConcurrentHashSetFindOrInsert
+ * ---------------------------------------
+ * Atomically looks for an element matching the one at elemAddr, enters a copy
+ * of it if there's no such element, and then calls updatefn (provided it's non-NULL)
+ * on the stored element, telling it whether the element was just inserted.  No
+ * other thread can get at the element until updatefn returns, which makes it
+ * the right place to finish initializing a freshly inserted element or to bump
+ * a counter embedded in an existing one.  Returns true if and only if
+ * the element was inserted.
+ */
+
+bool ConcurrentHashSetFindOrInsert(concurrenthashset *h, const void *elemAddr,
+				   ConcurrentHashSetUpdateFunction updatefn, void *auxData);
+
+/**
+ * Function: ConcurrentHashSetRemove
+ * ---------------------------------
+ * Thread-safe version of HashSetRemove.
+ */
+
+bool ConcurrentHashSetRemove(concurrenthashset *h, const void *elemAddr);
+
+/**
+ * Function: ConcurrentHashSetMap
+ * ------------------------------
+ * Thread-safe version of HashSetMap.  Shards are visited one at a time, and
+ * each is locked for as long as mapfn is being applied to its elements, so
+ * mapfn must not call back into the concurrenthashset.
+ */
+
+void ConcurrentHashSetMap(concurrenthashset *h, HashSetMapFunction mapfn, void *auxData);
+
+#endif
@@ -0,0 +1,150 @@
+#include "concurrenthashset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+struct tally {
+  int key;		// the number being counted
+  int occurrences;	// the number of times some thread has seen it
+};
+
+/**
+ * Function: HashTally
+ * -------------------
+ * Hash function used to partition tallies into buckets.  Keys are
+ * never negative, so a straight mod is enough.  Every call is counted,
+ * so the test can confirm that each operation hashes its element once.
+ */
+
+static long numHashCalls;
+static int HashTally(const void *elem, int numBuckets)
+{
+  __atomic_add_fetch(&numHashCalls, 1, __ATOMIC_RELAXED);
+  return ((const struct tally *)elem)->key % numBuckets;
+}
+
+static int CompareTally(const void *elem1, const void *elem2)
+{
+  return ((const struct tally *)elem1)->key - ((const struct tally *)elem2)->key;
+}
+
+/**
+ * Function: CountOccurrence
+ * -------------------------
+ * Update function handed to ConcurrentHashSetFindOrInsert.  A freshly
+ * inserted tally arrives with whatever occurrence count the caller put in
+ * it, so it gets reset before being bumped like all of the others.
+ */
+
+static void CountOccurrence(void *elem, bool inserted, void *numInsertions)
+{
+  struct tally *entry = elem;
+  if (inserted) {
+    entry->occurrences = 0;
+    (*(int *) numInsertions)++;
+  }
+  entry->occurrences++;
+}
+
+static void SumOccurrences(void *elem, void *total)
+{
+  *(long *) total += ((const struct tally *)elem)->occurrences;
+}
+
+typedef struct {
+  concurrenthashset *tallies;
+  int firstKey;
+  int numInsertions;
+} workerData;
+
+/**
+ * Function: CountKeys
+ * -------------------
+ * Thread routine that tallies kKeysPerThread consecutive keys starting at
+ * firstKey.  Neighboring threads are handed overlapping ranges, so most
+ * keys are tallied by two different threads, quite possibly at the same time.
+ */
+
+static const int kNumThreads = 16;
+static const int kKeysPerThread = 20000;
+static void *CountKeys(void *data)
+{
+  workerData *worker = data;
+  for (int key = worker->firstKey; key < worker->firstKey + kKeysPerThread; key++) {
+    struct tally entry = { key, 0 };
+    ConcurrentHashSetFindOrInsert(worker->tallies, &entry, CountOccurrence, &worker->numInsertions);
+  }
+
+  return NULL;
+}
+
+/**
+ * Function: TestConcurrentTallies
+ * -------------------------------
+ * Lets kNumThreads threads tally overlapping ranges of keys at the same time,
+ * and then confirms that every key was inserted exactly once, that the count
+ * is right, that not a single occurrence was lost along the way, and that
+ * no element was hashed more than once per operation, growth included.
+ */
+
+static void TestConcurrentTallies(void)
+{
+  concurrenthashset tallies;
+  pthread_t threads[kNumThreads];
+  workerData workers[kNumThreads];
+
+  fprintf(stdout, " ------------------------- Starting the concurrent tally test\n");
+  ConcurrentHashSetNew(&tallies, sizeof(struct tally), 1009, 32, HashTally, CompareTally, NULL);
+  for (int i = 0; i < kNumThreads; i++) {
+    workers[i].tallies = &tallies;
+    workers[i].firstKey = i * kKeysPerThread / 2;
+    workers[i].numInsertions = 0;
+    pthread_create(&threads[i], NULL, CountKeys, &workers[i]);
+  }
+
+  int numInsertions = 0;
+  for (int i = 0; i < kNumThreads; i++) {
+    pthread_join(threads[i], NULL);
+    numInsertions += workers[i].numInsertions;
+  }
+
+  int numDistinctKeys = (kNumThreads + 1) * kKeysPerThread / 2;
+  long totalOccurrences = 0;
+  ConcurrentHashSetMap(&tallies, SumOccurrences, &totalOccurrences);
+  assert(numInsertions == numDistinctKeys);
+  assert(ConcurrentHashSetCount(&tallies) == numDistinctKeys);
+  assert(totalOccurrences == (long) kNumThreads * kKeysPerThread);
+  assert(numHashCalls == (long) kNumThreads * kKeysPerThread);
+
+  for (int key = 0; key < numDistinctKeys; key++) {
+    struct tally entry = { key, 0 };
+    struct tally *found = ConcurrentHashSetLookup(&tallies, &entry);
+    assert(found != NULL);
+    int expected = (key < kKeysPerThread / 2 || key >= numDistinctKeys - kKeysPerThread / 2) ? 1 : 2;
+    assert(found->occurrences == expected);
+  }
+
+  fprintf(stdout, "%d threads tallied %ld keys, %d of them distinct, and every tally checks out.\n",
+	  kNumThreads, totalOccurrences, ConcurrentHashSetCount(&tallies));
+
+  for (int key = 0; key < numDistinctKeys; key += 2) {
+    struct tally entry = { key, 0 };
+    bool removed = ConcurrentHashSetRemove(&tallies, &entry);
+    assert(removed);
+    removed = ConcurrentHashSetRemove(&tallies, &entry);
+    assert(!removed);
+  }
+  assert(ConcurrentHashSetCount(&tallies) == numDistinctKeys / 2);
+  for (int key = 0; key < numDistinctKeys; key++) {
+    struct tally entry = { key, 0 };
+    assert((ConcurrentHashSetLookup(&tallies, &entry) != NULL) == (key % 2 == 1));
+  }
+  ConcurrentHashSetDispose(&tallies);
+}
+
+int main(int ununsed, char **alsoUnused)
+{
+  TestConcurrentTallies();
+  return 0;
+}
@@ -0,0 +1,371 @@
+/**
+ * File: containerbench.c
+ * ----------------------
+ * Times the core vector and hashset operations over a range of sizes and
+ * element sizes, printing one tab-separated line per measurement so that the
+ * output of two builds can be diffed (or pasted into a spreadsheet) directly.
+ *
+ * Every line has five columns:
+ *
+ *    operation   what was timed (hashset operations name the engine, too)
+ *    elemSize    the size of each element, in bytes
+ *    n           the number of elements in the container
+ *    nsPerOp     wall-clock nanoseconds per operation, averaged over the run
+ *    allocs      heap allocations and reallocations per repetition: vector
+ *                blocks, plus one every time a hashset moves to a bigger table
+ *
+ * Small containers are rebuilt and remeasured over and over, so that every
+ * line is averaged over at least kMinOpsPerLine operations.  The largest n
+ * measured is 10^6 unless a different limit is passed on the command line
+ * (container-bench 10000000 goes all the way up to 10^7).
+ */
+
+#include "vector.h"
+#include "vectorsort.h"
+#include "hashset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+static const int kElemSizes[] = { 1, 4, 8, 16, 64 };
+static const long kDefaultMaxN = 1000000;
+static const long kMinOpsPerLine = 1000000;
+static const long kMaxMovedPerInsertLine = 10000000; // elements shifted by the insert-at-front runs
+static const int kNumRandomPositions = 1 << 16;
+static const unsigned int kScrambler = 2654435761u;  // odd, so multiplying by it permutes the unsigned ints
+
+static volatile unsigned char sink; // keeps the compiler from optimizing reads away
+
+static double Now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Every element carries a key in its first four bytes (or in its only byte, for
+ * one-byte elements), and zeroes everywhere else.  The key of element i is i
+ * scrambled, so keys come out distinct but in no particular order.
+ */
+
+static unsigned int KeyOf(long i)
+{
+  return (unsigned int) i * kScrambler;
+}
+
+static void MakeElem(char *elem, int elemSize, unsigned int key)
+{
+  memset(elem, 0, elemSize);
+  memcpy(elem, &key, (elemSize < (int) sizeof(key)) ? elemSize : (int) sizeof(key));
+}
+
+static int CompareByteKeys(const void *elem1, const void *elem2)
+{
+  return *(const unsigned char *) elem1 - *(const unsigned char *) elem2;
+}
+
+static int CompareIntKeys(const void *elem1, const void *elem2)
+{
+  unsigned int key1, key2;
+  memcpy(&key1, elem1, sizeof(key1));
+  memcpy(&key2, elem2, sizeof(key2));
+  return (key1 > key2) - (key1 < key2);
+}
+
+static int HashIntKey(const void *elem, int numBuckets)
+{
+  unsigned int key;
+  memcpy(&key, elem, sizeof(key));
+  return key % numBuckets;
+}
+
+/**
+ * Counts heap allocations the same way the allocs column does, so
+ * a measurement is the difference between two calls.
+ */
+
+static long NumAllocations(void)
+{
+  vectorGlobalStats vectors;
+  hashsetGlobalStats hashsets;
+  VectorGlobalStats(&vectors);
+  HashSetGlobalStats(&hashsets);
+  return vectors.numAllocations + vectors.numReallocs + hashsets.numRehashes;
+}
+
+static void Report(const char *operation, int elemSize, long n, double seconds, long numOps,
+		   long numAllocations, long numRepetitions)
+{
+  printf("%s\t%d\t%ld\t%.2f\t%.1f\n", operation, elemSize, n, seconds * 1e9 / numOps,
+	 (double) numAllocations / numRepetitions);
+}
+
+static long RepetitionsFor(long numOpsPerRepetition)
+{
+  long numRepetitions = kMinOpsPerLine / numOpsPerRepetition;
+  return (numRepetitions > 0) ? numRepetitions : 1;
+}
+
+static void FillVector(vector *v, int elemSize, long n)
+{
+  char elem[elemSize];
+  VectorReserve(v, n);
+  for (long i = 0; i < n; i++) {
+    MakeElem(elem, elemSize, KeyOf(i));
+    VectorAppend(v, elem);
+  }
+}
+
+static void BenchmarkAppend(int elemSize, long n)
+{
+  char elem[elemSize];
+  MakeElem(elem, elemSize, KeyOf(1));
+  long numRepetitions = RepetitionsFor(n), allocsBefore = NumAllocations();
+  double start = Now();
+  for (long rep = 0; rep < numRepetitions; rep++) {
+    vector v;
+    VectorNew(&v, elemSize, NULL, 0);
+    for (long i = 0; i < n; i++)
+      VectorAppend(&v, elem);
+    VectorDispose(&v);
+  }
+  Report("vector.append", elemSize, n, Now() - start, numRepetitions * n,
+	 NumAllocations() - allocsBefore, numRepetitions);
+}
+
+/**
+ * Times building the same vector as BenchmarkAppend does, but with one
+ * VectorReserve and one VectorAppendMany, and then shrinking it to nothing
+ * and growing it back with VectorResize (which zero-fills the new elements).
+ */
+
+static void BenchmarkBulk(int elemSize, long n)
+{
+  char *elems = malloc(n * elemSize);
+  assert(elems != NULL);
+  for (long i = 0; i < n; i++)
+    MakeElem(elems + i * elemSize, elemSize, KeyOf(1));
+
+  long numRepetitions = RepetitionsFor(n), allocsBefore = NumAllocations();
+  double appendManySeconds = 0, resizeSeconds = 0;
+  for (long rep = 0; rep < numRepetitions; rep++) {
+    vector v;
+    VectorNew(&v, elemSize, NULL, 0);
+    double start = Now();
+    VectorReserve(&v, n);
+    VectorAppendMany(&v, elems, n);
+    appendManySeconds += Now() - start;
+    start = Now();
+    VectorResize(&v, 0);
+    VectorResize(&v, n);
+    resizeSeconds += Now() - start;
+    VectorDispose(&v);
+  }
+  Report("vector.append_many", elemSize, n, appendManySeconds, numRepetitions * n,
+	 NumAllocations() - allocsBefore, numRepetitions);
+  Report("vector.resize", elemSize, n, resizeSeconds, numRepetitions * n, 0, numRepetitions);
+  free(elems);
+}
+
+/**
+ * Inserting at the front shifts the entire vector over, so only a handful of
+ * insertions are timed against a vector that already holds n elements.
+ */
+
+static void BenchmarkInsertAtFront(int elemSize, long n)
+{
+  vector v;
+  char elem[elemSize];
+  long numInserts = kMaxMovedPerInsertLine / n;
+  if (numInserts > 1000) numInserts = 1000;
+  if (numInserts < 1) numInserts = 1;
+
+  VectorNew(&v, elemSize, NULL, 0);
+  FillVector(&v, elemSize, n);
+  MakeElem(elem, elemSize, KeyOf(1));
+  long allocsBefore = NumAllocations();
+  double start = Now();
+  for (long i = 0; i < numInserts; i++)
+    VectorInsert(&v, elem, 0);
+  Report("vector.insert_front", elemSize, n, Now() - start, numInserts, NumAllocations() - allocsBefore, 1);
+  VectorDispose(&v);
+}
+
+static void BenchmarkRandomNth(int elemSize, long n)
+{
+  vector v;
+  int *positions = malloc(kNumRandomPositions * sizeof(int));
+  assert(positions != NULL);
+  for (int i = 0; i < kNumRandomPositions; i++)
+    positions[i] = KeyOf(i + 1) % n;
+
+  VectorNew(&v, elemSize, NULL, 0);
+  FillVector(&v, elemSize, n);
+  long numOps = (n > kMinOpsPerLine) ? n : kMinOpsPerLine;
+  unsigned char checksum = 0;
+  double start = Now();
+  for (long i = 0; i < numOps; i++)
+    checksum += *(unsigned char *) VectorNth(&v, positions[i & (kNumRandomPositions - 1)]);
+  Report("vector.nth_random", elemSize, n, Now() - start, numOps, 0, 1);
+  sink = checksum;
+  VectorDispose(&v);
+  free(positions);
+}
+
+/**
+ * Times VectorSort on scrambled keys, and then binary searches (through
+ * VectorSearch) for keys that are known to be present.
+ */
+
+static void BenchmarkSortAndSearch(int elemSize, long n)
+{
+  VectorCompareFunction cmp = (elemSize == 1) ? CompareByteKeys : CompareIntKeys;
+  long numRepetitions = RepetitionsFor(n);
+  double sortSeconds = 0;
+  vector v;
+  for (long rep = 0; rep < numRepetitions; rep++) {
+    VectorNew(&v, elemSize, NULL, 0);
+    FillVector(&v, elemSize, n);
+    double start = Now();
+    VectorSort(&v, cmp);
+    sortSeconds += Now() - start;
+    if (rep + 1 < numRepetitions) VectorDispose(&v);
+  }
+  Report("vector.sort", elemSize, n, sortSeconds, numRepetitions * n, 0, numRepetitions);
+
+  char elem[elemSize];
+  long numSearches = (n > kMinOpsPerLine) ? n : kMinOpsPerLine;
+  int numFound = 0;
+  double start = Now();
+  for (long i = 0; i < numSearches; i++) {
+    MakeElem(elem, elemSize, KeyOf(i % n));
+    numFound += VectorSearch(&v, elem, cmp, 0, true) >= 0;
+  }
+  Report("vector.search", elemSize, n, Now() - start, numSearches, 0, 1);
+  assert(numFound == numSearches);
+  VectorDispose(&v);
+}
+
+/**
+ * Times the introsort and branchless search generated by vectorsort.h, and the
+ * radix sort behind VectorSortIntegers, on the same scrambled keys that
+ * vector.sort and vector.search use.  All three only know about one element
+ * type, so they're measured on longs alone.
+ */
+
+#define LongLess(a, b) ((a) < (b))
+VECTOR_DEFINE_SORT(SortLongs, long, LongLess)
+VECTOR_DEFINE_SEARCH(SearchLongs, long, LongLess)
+
+static void FillLongs(vector *v, long n)
+{
+  VectorReserve(v, n);
+  for (long i = 0; i < n; i++) {
+    long key = KeyOf(i);
+    VectorAppend(v, &key);
+  }
+}
+
+static void BenchmarkTypedSortAndSearch(long n)
+{
+  long numRepetitions = RepetitionsFor(n);
+  double introsortSeconds = 0, radixSortSeconds = 0;
+  vector v;
+  for (long rep = 0; rep < numRepetitions; rep++) {
+    VectorNew(&v, sizeof(long), NULL, 0);
+    FillLongs(&v, n);
+    double start = Now();
+    SortLongs(&v);
+    introsortSeconds += Now() - start;
+    VectorDispose(&v);
+
+    VectorNew(&v, sizeof(long), NULL, 0);
+    FillLongs(&v, n);
+    start = Now();
+    VectorSortIntegers(&v);
+    radixSortSeconds += Now() - start;
+    if (rep + 1 < numRepetitions) VectorDispose(&v);
+  }
+  Report("vector.sort_typed", sizeof(long), n, introsortSeconds, numRepetitions * n, 0, numRepetitions);
+  Report("vector.sort_radix", sizeof(long), n, radixSortSeconds, numRepetitions * n, 0, numRepetitions);
+
+  long numSearches = (n > kMinOpsPerLine) ? n : kMinOpsPerLine;
+  int numFound = 0;
+  double start = Now();
+  for (long i = 0; i < numSearches; i++)
+    numFound += SearchLongs(&v, KeyOf(i % n)) >= 0;
+  Report("vector.search_branchless", sizeof(long), n, Now() - start, numSearches, 0, 1);
+  assert(numFound == numSearches);
+  VectorDispose(&v);
+}
+
+/**
+ * Times HashSetEnter on a hashset that starts out small and has to grow
+ * its way up to n elements, and then HashSetLookup for keys that are present
+ * and for keys that aren't.  Keys are four bytes long, so one-byte
+ * elements are skipped.
+ */
+
+static void BenchmarkHashSet(HashSetEngine engine, const char *engineName, int elemSize, long n)
+{
+  char name[64], elem[elemSize];
+  long numRepetitions = RepetitionsFor(n), allocsBefore = NumAllocations();
+  double enterSeconds = 0;
+  hashset h;
+  for (long rep = 0; rep < numRepetitions; rep++) {
+    HashSetNewUsingEngine(&h, elemSize, 1009, HashIntKey, CompareIntKeys, NULL, engine);
+    double start = Now();
+    for (long i = 0; i < n; i++) {
+      MakeElem(elem, elemSize, KeyOf(i));
+      HashSetEnter(&h, elem);
+    }
+    enterSeconds += Now() - start;
+    if (rep + 1 < numRepetitions) HashSetDispose(&h);
+  }
+  snprintf(name, sizeof(name), "hashset.enter.%s", engineName);
+  Report(name, elemSize, n, enterSeconds, numRepetitions * n, NumAllocations() - allocsBefore, numRepetitions);
+
+  long numLookups = (n > kMinOpsPerLine) ? n : kMinOpsPerLine;
+  for (int hit = 1; hit >= 0; hit--) {
+    long numFound = 0;
+    double start = Now();
+    for (long i = 0; i < numLookups; i++) {
+      MakeElem(elem, elemSize, KeyOf(hit ? (i * 7) % n : n + i));
+      numFound += HashSetLookup(&h, elem) != NULL;
+    }
+    snprintf(name, sizeof(name), "hashset.lookup_%s.%s", hit ? "hit" : "miss", engineName);
+    Report(name, elemSize, n, Now() - start, numLookups, 0, 1);
+    assert(numFound == (hit ? numLookups : 0));
+  }
+  HashSetDispose(&h);
+}
+
+int main(int argc, char **argv)
+{
+  long maxN = (argc > 1) ? atol(argv[1]) : kDefaultMaxN;
+  assert(maxN >= 1000);
+
+  printf("# operation\telemSize\tn\tnsPerOp\tallocs\n");
+  for (int e = 0; e < (int) (sizeof(kElemSizes) / sizeof(kElemSizes[0])); e++) {
+    int elemSize = kElemSizes[e];
+    for (long n = 1000; n <= maxN; n *= 10) {
+      BenchmarkAppend(elemSize, n);
+      BenchmarkBulk(elemSize, n);
+      BenchmarkInsertAtFront(elemSize, n);
+      BenchmarkRandomNth(elemSize, n);
+      BenchmarkSortAndSearch(elemSize, n);
+      if (elemSize == (int) sizeof(long))
+	BenchmarkTypedSortAndSearch(n);
+      if (elemSize >= (int) sizeof(unsigned int)) {
+	BenchmarkHashSet(kHashSetChaining, "chaining", elemSize, n);
+	BenchmarkHashSet(kHashSetOpenAddressing, "open_addressing", elemSize, n);
+      }
+      fflush(stdout);
+    }
+  }
+
+  return 0;
+}
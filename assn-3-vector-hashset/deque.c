@@ -0,0 +1,139 @@
+#include "deque.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static const int kDefaultCapacity = 8;
+
+/**
+ * Returns the address of the element numbered position, without
+ * checking that there is such an element.
+ */
+
+static char *Slot(const deque *d, int position)
+{
+  return d->elems + ((d->head + position) & (d->capacity - 1)) * d->elemSize;
+}
+
+void DequeNew(deque *d, int elemSize, VectorFreeFunction freefn, int initialAllocation)
+{
+  assert(elemSize > 0);
+  assert(initialAllocation >= 0);
+  d->capacity = 1;
+  while (d->capacity < ((initialAllocation == 0) ? kDefaultCapacity : initialAllocation))
+    d->capacity *= 2;
+  d->elemSize = elemSize;
+  d->freeFn = freefn;
+  d->head = 0;
+  d->length = 0;
+  d->elems = malloc(d->capacity * elemSize);
+  assert(d->elems != NULL);
+}
+
+void DequeDispose(deque *d)
+{
+  if (d->freeFn != NULL)
+    for (int i = 0; i < d->length; i++)
+      d->freeFn(Slot(d, i));
+  free(d->elems);
+}
+
+int DequeLength(const deque *d)
+{
+  return d->length;
+}
+
+void *DequeNth(const deque *d, int position)
+{
+  assert(position >= 0);
+  assert(position < d->length);
+  return Slot(d, position);
+}
+
+/**
+ * Doubles the capacity when the deque is full.  The elements are unwrapped
+ * on the way over, so element 0 lands at the start of the new array.
+ */
+
+static void GrowIfFull(deque *d)
+{
+  if (d->length < d->capacity)
+    return;
+
+  char *elems = malloc(2 * d->capacity * d->elemSize);
+  assert(elems != NULL);
+  int numBeforeWrap = d->capacity - d->head;
+  memcpy(elems, d->elems + d->head * d->elemSize, numBeforeWrap * d->elemSize);
+  memcpy(elems + numBeforeWrap * d->elemSize, d->elems, d->head * d->elemSize);
+  free(d->elems);
+  d->elems = elems;
+  d->head = 0;
+  d->capacity *= 2;
+}
+
+void DequePushFront(deque *d, const void *elemAddr)
+{
+  assert(elemAddr != NULL);
+  GrowIfFull(d);
+  d->head = (d->head - 1) & (d->capacity - 1);
+  d->length++;
+  memcpy(Slot(d, 0), elemAddr, d->elemSize);
+}
+
+void DequePushBack(deque *d, const void *elemAddr)
+{
+  assert(elemAddr != NULL);
+  GrowIfFull(d);
+  memcpy(Slot(d, d->length), elemAddr, d->elemSize);
+  d->length++;
+}
+
+void DequePopFront(deque *d, void *elemAddr)
+{
+  assert(elemAddr != NULL);
+  assert(d->length > 0);
+  memcpy(elemAddr, Slot(d, 0), d->elemSize);
+  d->head = (d->head + 1) & (d->capacity - 1);
+  d->length--;
+}
+
+void DequePopBack(deque *d, void *elemAddr)
+{
+  assert(elemAddr != NULL);
+  assert(d->length > 0);
+  memcpy(elemAddr, Slot(d, d->length - 1), d->elemSize);
+  d->length--;
+}
+
+void DequeReplace(deque *d, const void *elemAddr, int position)
+{
+  assert(elemAddr != NULL);
+  void *elem = DequeNth(d, position);
+  if (d->freeFn != NULL)
+    d->freeFn(elem);
+  memcpy(elem, elemAddr, d->elemSize);
+}
+
+void DequeDelete(deque *d, int position)
+{
+  void *elem = DequeNth(d, position);
+  if (d->freeFn != NULL)
+    d->freeFn(elem);
+
+  if (position < d->length - 1 - position) {
+    for (int i = position; i > 0; i--)
+      memcpy(Slot(d, i), Slot(d, i - 1), d->elemSize);
+    d->head = (d->head + 1) & (d->capacity - 1);
+  } else {
+    for (int i = position; i < d->length - 1; i++)
+      memcpy(Slot(d, i), Slot(d, i + 1), d->elemSize);
+  }
+  d->length--;
+}
+
+void DequeMap(deque *d, VectorMapFunction mapfn, void *auxData)
+{
+  assert(mapfn != NULL);
+  for (int i = 0; i < d->length; i++)
+    mapfn(Slot(d, i), auxData);
+}
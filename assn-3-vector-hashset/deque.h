@@ -0,0 +1,142 @@
+#ifndef _deque_
+#define _deque_
+#include "vector.h"
+
+/* File: deque.h
+ * -------------
+ * Defines the interface for the deque, a companion to the vector for
+ * queue-like workloads.
+ *
+ * The vector stores its elements from the start of its array, so
+ * inserting or deleting near the front shifts everything behind it.
+ * The deque stores its elements in a ring buffer instead: the first
+ * element can sit anywhere in the array, and the elements wrap around
+ * from the end of the array back to its start.  That makes adding and
+ * removing elements at either end O(1) (neglecting the occasional
+ * reallocation), while DequeNth still runs in constant time.
+ *
+ * The element, free, and map function conventions are exactly those
+ * of the vector.
+ */
+
+/**
+ * Type: deque
+ * -----------
+ * The concrete representation of the deque.  In spite of all
+ * of the fields being publicly accessible, the client is absolutely
+ * required to initialize, inspect, and update the deque using
+ * only those functions defined below.
+ */
+
+typedef struct {
+  int elemSize;
+  int capacity;      // always a power of two, so positions wrap around with a mask
+  int head;          // index within elems of element 0
+  int length;
+  char *elems;
+  VectorFreeFunction freeFn;
+} deque;
+
+/**
+ * Function: DequeNew
+ * ------------------
+ * Constructs a raw or previously destroyed deque to be the empty deque.
+ * elemSize and freefn mean exactly what they mean to VectorNew.
+ * initialAllocation is rounded up to a power of two; 0 gets a small
+ * default.  The capacity doubles whenever the deque fills up.
+ *
+ * An assert is raised if elemSize isn't positive or initialAllocation
+ * is negative.
+ */
+
+void DequeNew(deque *d, int elemSize, VectorFreeFunction freefn, int initialAllocation);
+
+/**
+ * Function: DequeDispose
+ * ----------------------
+ * Levies the free function against every element and releases
+ * the deque's storage.
+ */
+
+void DequeDispose(deque *d);
+
+/**
+ * Function: DequeLength
+ * ---------------------
+ * Returns the number of elements in the deque.
+ */
+
+int DequeLength(const deque *d);
+
+/**
+ * Function: DequeNth
+ * ------------------
+ * Returns the address of the element numbered position, where element 0
+ * is the one at the front.  Runs in constant time.  As with VectorNth,
+ * the address is invalidated by any call that adds or removes elements.
+ *
+ * An assert is raised if position is less than 0 or greater than
+ * the length minus 1.
+ */
+
+void *DequeNth(const deque *d, int position);
+
+/**
+ * Functions: DequePushFront, DequePushBack
+ * ----------------------------------------
+ * Copies the element at elemAddr onto the front (or back) of the deque.
+ * Both run in amortized constant time.
+ */
+
+void DequePushFront(deque *d, const void *elemAddr);
+void DequePushBack(deque *d, const void *elemAddr);
+
+/**
+ * Functions: DequePopFront, DequePopBack
+ * --------------------------------------
+ * Removes the element at the front (or back) of the deque, copying it into
+ * the space at elemAddr.  Responsibility for whatever the element owns passes
+ * to the client along with it, so the free function is *not* called.  Both
+ * run in constant time.
+ *
+ * An assert is raised if the deque is empty or elemAddr is NULL.
+ */
+
+void DequePopFront(deque *d, void *elemAddr);
+void DequePopBack(deque *d, void *elemAddr);
+
+/**
+ * Function: DequeReplace
+ * ----------------------
+ * Overwrites the element at the specified position, after levying the
+ * free function against it, just as VectorReplace does.
+ *
+ * An assert is raised if position is out of range.
+ */
+
+void DequeReplace(deque *d, const void *elemAddr, int position);
+
+/**
+ * Function: DequeDelete
+ * ---------------------
+ * Deletes the element at the specified position, after levying the free
+ * function against it.  The gap is closed by shifting over whichever side
+ * of it is shorter, so deleting near either end is cheap; the cost is
+ * proportional to the distance from the nearer end.
+ *
+ * An assert is raised if position is out of range.
+ */
+
+void DequeDelete(deque *d, int position);
+
+/**
+ * Function: DequeMap
+ * ------------------
+ * Calls mapfn on every element, from front to back, just as VectorMap does.
+ *
+ * An assert is raised if mapfn is NULL.
+ */
+
+void DequeMap(deque *d, VectorMapFunction mapfn, void *auxData);
+
+#endif
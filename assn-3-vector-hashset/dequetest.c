@@ -0,0 +1,174 @@
+#include "deque.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+static void PrintChar(void *elem, void *fp)
+{
+  fprintf((FILE *)fp, "%c", *(char *)elem);
+}
+
+/**
+ * Function: TestBothEnds
+ * ----------------------
+ * Builds the alphabet from the middle out, pushing onto both ends of
+ * a deque that starts out far too small, so the elements wrap around
+ * the end of the ring buffer several times along the way.  Then it
+ * takes the deque apart from both ends.
+ */
+
+static void TestBothEnds(void)
+{
+  deque letters;
+  fprintf(stdout, " ------------------------- Starting the deque test\n");
+  DequeNew(&letters, sizeof(char), NULL, 1);
+  for (char ch = 'm'; ch >= 'a'; ch--) {
+    char next = 'a' + 'z' - ch;
+    DequePushFront(&letters, &ch);
+    DequePushBack(&letters, &next);
+  }
+
+  assert(DequeLength(&letters) == 26);
+  for (int i = 0; i < 26; i++)
+    assert(*(char *) DequeNth(&letters, i) == 'a' + i);
+  fprintf(stdout, "The alphabet, built from the middle out: ");
+  DequeMap(&letters, PrintChar, stdout);
+  fprintf(stdout, "\n");
+
+  char front, back;
+  while (DequeLength(&letters) > 0) {
+    int length = DequeLength(&letters);
+    DequePopFront(&letters, &front);
+    DequePopBack(&letters, &back);
+    assert(front + back == 'a' + 'z');
+    assert(front == 'a' + (26 - length) / 2);
+  }
+  DequeDispose(&letters);
+}
+
+/**
+ * Function: TestDeleteMatchesVector
+ * ---------------------------------
+ * Deletes elements from random positions of a deque and a vector that start
+ * out with the same contents, confirming after every deletion that the
+ * two agree.  The deque's head is moved off 0 first, so deletions close
+ * gaps from both directions and across the wrap.
+ */
+
+static void TestDeleteMatchesVector(void)
+{
+  deque numbers;
+  vector expected;
+  DequeNew(&numbers, sizeof(int), NULL, 0);
+  VectorNew(&expected, sizeof(int), NULL, 0);
+  for (int i = 0; i < 1000; i++) {
+    DequePushBack(&numbers, &i);
+    VectorAppend(&expected, &i);
+  }
+  for (int i = 0; i < 300; i++) {
+    int popped;
+    DequePopFront(&numbers, &popped);
+    DequePushBack(&numbers, &popped);
+    VectorDelete(&expected, 0);
+    VectorAppend(&expected, &popped);
+  }
+
+  while (DequeLength(&numbers) > 0) {
+    int position = rand() % DequeLength(&numbers);
+    DequeDelete(&numbers, position);
+    VectorDelete(&expected, position);
+    assert(DequeLength(&numbers) == VectorLength(&expected));
+    for (int i = 0; i < DequeLength(&numbers); i++)
+      assert(*(int *) DequeNth(&numbers, i) == *(int *) VectorNth(&expected, i));
+  }
+
+  fprintf(stdout, "Random deletions leave the deque and the vector in agreement.\n");
+  DequeDispose(&numbers);
+  VectorDispose(&expected);
+}
+
+static void FreeString(void *elemAddr)
+{
+  free(*(char **) elemAddr);
+}
+
+/**
+ * Function: TestFreeFunction
+ * --------------------------
+ * Makes sure the free function is levied against deleted, replaced, and
+ * disposed-of elements but not popped ones (which the client now owns).
+ * Run it under valgrind or a sanitizer to catch leaks and double frees.
+ */
+
+static void TestFreeFunction(void)
+{
+  deque words;
+  const char *const kWords[] = { "front", "to", "back", "and", "back", "again" };
+  DequeNew(&words, sizeof(char *), FreeString, 2);
+  for (int i = 0; i < sizeof(kWords) / sizeof(kWords[0]); i++) {
+    char *word = strdup(kWords[i]);
+    DequePushBack(&words, &word);
+  }
+
+  char *popped;
+  DequePopFront(&words, &popped);
+  assert(strcmp(popped, "front") == 0);
+  free(popped);
+  char *replacement = strdup("forth");
+  DequeReplace(&words, &replacement, 2);
+  DequeDelete(&words, 1);
+  assert(strcmp(*(char **) DequeNth(&words, 1), "forth") == 0);
+  DequeDispose(&words);
+}
+
+/**
+ * Function: QueueBenchmark
+ * ------------------------
+ * Uses a vector and a deque as a FIFO queue of longs: append everything
+ * at the back, then remove everything from the front.  The vector shifts
+ * the entire tail over for every removal, while the deque just moves its
+ * head along.
+ */
+
+static const int kNumQueued = 50000;
+static void QueueBenchmark(void)
+{
+  vector viaVector;
+  deque viaDeque;
+  fprintf(stdout, "\n\n ------------------------- Starting the queue benchmark\n");
+  VectorNew(&viaVector, sizeof(long), NULL, 0);
+  DequeNew(&viaDeque, sizeof(long), NULL, 0);
+
+  clock_t start = clock();
+  for (long i = 0; i < kNumQueued; i++) VectorAppend(&viaVector, &i);
+  for (long i = 0; i < kNumQueued; i++) {
+    assert(*(long *) VectorNth(&viaVector, 0) == i);
+    VectorDelete(&viaVector, 0);
+  }
+  fprintf(stdout, "Queued and dequeued %d longs with a vector in %.3f seconds.\n",
+	  kNumQueued, (double) (clock() - start) / CLOCKS_PER_SEC);
+
+  start = clock();
+  for (long i = 0; i < kNumQueued; i++) DequePushBack(&viaDeque, &i);
+  for (long i = 0; i < kNumQueued; i++) {
+    long front;
+    DequePopFront(&viaDeque, &front);
+    assert(front == i);
+  }
+  fprintf(stdout, "Queued and dequeued %d longs with a deque in %.3f seconds.\n",
+	  kNumQueued, (double) (clock() - start) / CLOCKS_PER_SEC);
+
+  VectorDispose(&viaVector);
+  DequeDispose(&viaDeque);
+}
+
+int main(int ununsed, char **alsoUnused)
+{
+  TestBothEnds();
+  TestDeleteMatchesVector();
+  TestFreeFunction();
+  QueueBenchmark();
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
 /*
 
 typedef struct {
@@ -15,10 +16,105 @@ typedef struct {
 
 */
 
+static const unsigned short kEmptySlot = 0;
+static const unsigned short kMaxProbeLength = USHRT_MAX;
+static const int kChainingMaxLoadPercent = 200;        // chaining grows once buckets average two elements
+static const int kOpenAddressingMaxLoadPercent = 80;   // open addressing grows once 80% of the slots are taken
+static const int kBucketsMigratedPerEnter = 4;
+static const int kFullHashRange = INT_MAX;             // cached hash codes are computed as if there were this many buckets
+static const int kMaxRecordAlignment = 16;
 
+/**
+ * Memory accounting for every hashset table in the program, updated atomically
+ * since hashsets are used from several threads at once.  Only table creation,
+ * table disposal, and rehashing touch it.  Tables carved from a client's
+ * allocator aren't heap memory, so they're left out.
+ */
 
-void HashSetNew(hashset *h, int elemSize, int numBuckets,
-		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn)
+static hashsetGlobalStats globalStats;
+
+static void RecordHeapChange(const hashset *h, long numBytes)
+{
+  if (h->alloc != NULL) return;
+  long live = __atomic_add_fetch(&globalStats.bytesReserved, numBytes, __ATOMIC_RELAXED);
+  long peak = __atomic_load_n(&globalStats.peakBytesReserved, __ATOMIC_RELAXED);
+  while (live > peak &&
+	 !__atomic_compare_exchange_n(&globalStats.peakBytesReserved, &peak, live, true,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+/**
+ * Returns the number of bytes the table itself occupies, not counting
+ * whatever heap memory the chaining buckets hold onto.
+ */
+
+static long TableBytes(const hashset *h, const hashsetTable *table)
+{
+  if (h->engine == kHashSetChaining)
+    return (long) table->numBuckets * sizeof(vector);
+  long bytesPerSlot = h->elemSize + sizeof(unsigned short) + (h->cachesHashCodes ? sizeof(int) : 0);
+  return table->numBuckets * bytesPerSlot;
+}
+
+static int MaxLoadPercent(const hashset *h)
+{
+  return (h->engine == kHashSetOpenAddressing) ? kOpenAddressingMaxLoadPercent : kChainingMaxLoadPercent;
+}
+
+static bool Growing(const hashset *h)
+{
+  return h->retiring.numBuckets > 0;
+}
+
+static void TableNew(hashset *h, hashsetTable *table, int numBuckets)
+{
+  table->numBuckets = numBuckets;
+  table->buckets = NULL;
+  table->slots = NULL;
+  table->probeLengths = NULL;
+  table->hashCodes = NULL;
+  RecordHeapChange(h, TableBytes(h, table));
+
+  if (h->engine == kHashSetOpenAddressing) {
+    table->slots = AllocatorAllocate(h->alloc, (size_t) numBuckets * h->elemSize);
+    table->probeLengths = AllocatorAllocate(h->alloc, numBuckets * sizeof(unsigned short));
+    assert(table->slots != NULL && table->probeLengths != NULL);
+    memset(table->probeLengths, 0, numBuckets * sizeof(unsigned short));
+    if (h->cachesHashCodes) {
+      table->hashCodes = AllocatorAllocate(h->alloc, numBuckets * sizeof(int));
+      assert(table->hashCodes != NULL);
+    }
+    return;
+  }
+
+  table->buckets = AllocatorAllocate(h->alloc, numBuckets*sizeof(vector));
+  assert(table->buckets!=NULL);
+
+  // buckets never free elements themselves: the hashset levies freeFn, since
+  // elements migrating between tables must outlive the bucket they came from.
+  // Short chains fit in a bucket's inline buffer, so most never allocate.
+  for(int i=0; i<numBuckets;i++)
+    VectorNewUsingAllocator(&table->buckets[i],h->recordSize,NULL, 0, h->alloc);
+}
+
+static int RoundUp(int n, int multiple)
+{
+  return (n + multiple - 1) / multiple * multiple;
+}
+
+/**
+ * With cached hash codes, chaining buckets store records instead of bare
+ * elements: the element comes first (so the address of a record is also
+ * the address of its element), followed by the hash code.  The record size
+ * is rounded up to a multiple of the element's alignment, which must divide
+ * elemSize and is therefore at most the largest power of two dividing it.
+ */
+
+static void HashSetInit(hashset *h, int elemSize, int numBuckets,
+			HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+			HashSetFreeFunction freefn, HashSetEngine engine, bool cacheHashCodes,
+			const allocator *alloc)
 {
   assert (elemSize>0);
   assert (numBuckets>0);
@@ -28,76 +124,699 @@ void HashSetNew(hashset *h, int elemSize, int numBuckets,
   h->compareFn = comparefn;
   h->length = 0;
   h->hashFn = hashfn;
-  //h->freeFn = freefn;
-  //h->elemSize = elemSize;
-  h->data = malloc(numBuckets*sizeof(vector));
-  
-  assert(h->data!=NULL);
-  h->numBuckets = numBuckets;
-  
-  
-  for(int i=0; i<numBuckets;i++)
-    VectorNew(&h->data[i],elemSize,freefn, 0);
-     
+  h->freeFn = freefn;
+  h->elemSize = elemSize;
+  h->engine = engine;
+  h->cachesHashCodes = cacheHashCodes;
+  h->recordSize = elemSize;
+  h->hashCodeOffset = elemSize;
+  if (cacheHashCodes) {
+    h->hashCodeOffset = RoundUp(elemSize, sizeof(int));
+    int alignment = elemSize & -elemSize;
+    if (alignment < (int) sizeof(int)) alignment = sizeof(int);
+    if (alignment > kMaxRecordAlignment) alignment = kMaxRecordAlignment;
+    h->recordSize = RoundUp(h->hashCodeOffset + sizeof(int), alignment);
+  }
+  h->retiring.numBuckets = 0;
+  h->retiringLength = 0;
+  h->migrated = 0;
+  h->numRehashes = 0;
+  h->alloc = alloc;
+  TableNew(h, &h->table, numBuckets);
+}
+
+void HashSetNew(hashset *h, int elemSize, int numBuckets,
+		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn)
+{
+  HashSetInit(h, elemSize, numBuckets, hashfn, comparefn, freefn, kHashSetChaining, false, NULL);
+}
+
+void HashSetNewUsingEngine(hashset *h, int elemSize, int numBuckets,
+			   HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+			   HashSetFreeFunction freefn, HashSetEngine engine)
+{
+  HashSetInit(h, elemSize, numBuckets, hashfn, comparefn, freefn, engine, false, NULL);
+}
+
+void HashSetNewCachingHashCodes(hashset *h, int elemSize, int numBuckets,
+				HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+				HashSetFreeFunction freefn, HashSetEngine engine)
+{
+  HashSetInit(h, elemSize, numBuckets, hashfn, comparefn, freefn, engine, true, NULL);
+}
+
+void HashSetNewUsingAllocator(hashset *h, int elemSize, int numBuckets,
+			      HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+			      HashSetFreeFunction freefn, HashSetEngine engine, const allocator *alloc)
+{
+  HashSetInit(h, elemSize, numBuckets, hashfn, comparefn, freefn, engine, false, alloc);
+}
+
+static void *SlotAddress(const hashset *h, const hashsetTable *table, int slot)
+{
+  return table->slots + (size_t) slot * h->elemSize;
+}
+
+static bool SlotInUse(const hashsetTable *table, int slot)
+{
+  return table->probeLengths[slot] != kEmptySlot;
+}
+
+/**
+ * Levies the hashset's free function against every element living in the
+ * specified table, starting with bucket firstBucket (the ones before it have
+ * already been drained), and then releases the table's own memory.
+ */
+
+static void TableDispose(hashset *h, hashsetTable *table, int firstBucket)
+{
+  RecordHeapChange(h, -TableBytes(h, table));
+  if (h->engine == kHashSetOpenAddressing) {
+    if (h->freeFn != NULL)
+      for (int slot = firstBucket; slot < table->numBuckets; slot++)
+	if (SlotInUse(table, slot))
+	  h->freeFn(SlotAddress(h, table, slot));
+    AllocatorRelease(h->alloc, table->slots, (size_t) table->numBuckets * h->elemSize);
+    AllocatorRelease(h->alloc, table->probeLengths, table->numBuckets * sizeof(unsigned short));
+    if (table->hashCodes != NULL)
+      AllocatorRelease(h->alloc, table->hashCodes, table->numBuckets * sizeof(int));
+    return;
+  }
+
+  for(int bucket =firstBucket; bucket<table->numBuckets;bucket++) {
+    vector *chain = &table->buckets[bucket];
+    if (h->freeFn != NULL)
+      for (int i = 0; i < VectorLength(chain); i++)
+	h->freeFn(VectorNth(chain, i));
+    VectorDispose(chain);
+  }
+  AllocatorRelease(h->alloc, table->buckets, table->numBuckets * sizeof(vector));
 }
 
 void HashSetDispose(hashset *h)
 {
-  for(int bucket =0; bucket<h->numBuckets;bucket++)
-    //if(VectorIsNull(&h->data[bucket])!=1)
-    VectorDispose(&h->data[bucket]);
-  free(h->data); 
+  if (Growing(h))
+    TableDispose(h, &h->retiring, h->migrated);
+  TableDispose(h, &h->table, 0);
 }
 
 int HashSetCount(const hashset *h)
 { return  h->length; }
 
+static void TableMap(const hashset *h, const hashsetTable *table, int firstBucket,
+		     HashSetMapFunction mapfn, void *auxData)
+{
+  if (h->engine == kHashSetOpenAddressing) {
+    for (int slot = firstBucket; slot < table->numBuckets; slot++)
+      if (SlotInUse(table, slot))
+	mapfn(SlotAddress(h, table, slot), auxData);
+    return;
+  }
+
+  for(int bucket=firstBucket; bucket< table->numBuckets;bucket++)
+    VectorMap(&table->buckets[bucket] ,mapfn, auxData);
+}
+
 void HashSetMap(hashset *h, HashSetMapFunction mapfn, void *auxData)
 {
   assert(mapfn!=NULL);
-  for(int bucket=0; bucket< h->numBuckets;bucket++)
-    //if(VectorIsNull(&h->data[bucket])!=1)
-    VectorMap(&h->data[bucket] ,mapfn, auxData);
+  if (Growing(h))
+    TableMap(h, &h->retiring, h->migrated, mapfn, auxData);
+  TableMap(h, &h->table, 0, mapfn, auxData);
+}
+
+/**
+ * Returns the hash code cached alongside the element, or 0 if
+ * the hashset doesn't cache hash codes.
+ */
+
+static int HashCode(const hashset *h, const void *elemAddr)
+{
+  if (!h->cachesHashCodes) return 0;
+  assert(elemAddr != NULL);
+  int hashCode = h->hashFn(elemAddr, kFullHashRange);
+  assert(hashCode >= 0 && hashCode < kFullHashRange);
+  return hashCode;
+}
+
+/**
+ * Vets a hash code handed in by a client of the ...WithHashCode functions,
+ * which only make sense for hashsets that cache hash codes.
+ */
+
+static int SuppliedHashCode(const hashset *h, const void *elemAddr, int hashCode)
+{
+  assert(h->cachesHashCodes);
+  assert(elemAddr != NULL);
+  assert(hashCode >= 0 && hashCode < kFullHashRange);
+  return hashCode;
 }
 
-int findElemBucket(const hashset *h, const void *elemAddr ){
+static int StoredHashCode(const hashset *h, const void *record)
+{
+  return *(const int *)((const char *) record + h->hashCodeOffset);
+}
+
+static int findElemBucket(const hashset *h, const hashsetTable *table, const void *elemAddr, int hashCode ){
 
   assert(elemAddr !=NULL);
-  int bucket = h->hashFn(elemAddr, h->numBuckets);
-  assert(bucket>=0 && bucket < h->numBuckets);
+  if (h->cachesHashCodes) return hashCode % table->numBuckets;
+  int bucket = h->hashFn(elemAddr, table->numBuckets);
+  assert(bucket>=0 && bucket < table->numBuckets);
   return bucket;
 
 }
 
 static const int kNotFound = -1;
+
+/**
+ * Walks the probe sequence starting at the element's home slot.  The
+ * Robin Hood invariant guarantees that the probe lengths seen along the
+ * way never fall below our own until we pass the place where the key
+ * would have been planted, so we can quit early on a miss.  Only slots
+ * whose probe length equals ours share our home slot, so those are the
+ * only ones worth handing to the comparator (and if hash codes are
+ * cached, only the ones whose hash codes match ours).
+ *
+ * Slots of a retiring table are drained in order, so everything before
+ * h->migrated is gone and the walk can jump straight past it.  Nothing
+ * else in a retiring table ever moves, so the invariant still holds
+ * for the slots that are left.
+ */
+
+static int OpenAddressingFind(const hashset *h, const hashsetTable *table, const void *elemAddr,
+			      int hashCode, int home)
+{
+  int firstLiveSlot = (table == &h->retiring) ? h->migrated : 0;
+  int slot = home;
+  for (unsigned int probe = 1; probe <= kMaxProbeLength; probe++) {
+    if (slot < firstLiveSlot) {
+      probe += firstLiveSlot - slot;
+      slot = firstLiveSlot;
+      if (probe > kMaxProbeLength) break;
+    }
+    unsigned short existing = table->probeLengths[slot];
+    if (existing < probe) return kNotFound;
+    if (existing == probe && (!h->cachesHashCodes || table->hashCodes[slot] == hashCode) &&
+	h->compareFn(elemAddr, SlotAddress(h, table, slot)) == 0)
+      return slot;
+    if (++slot == table->numBuckets) slot = 0;
+  }
+
+  return kNotFound;
+}
+
+/**
+ * Plants a copy of the element (known to be absent) in the slab, starting
+ * at its home slot and swapping it with any resident element that's closer
+ * to its own home than the one being carried.  The displaced element
+ * is then carried forward in turn until an empty slot turns up.
+ */
+
+static void *OpenAddressingPlace(hashset *h, hashsetTable *table, const void *elemAddr,
+				 int hashCode, int home)
+{
+  char carried[h->elemSize], displaced[h->elemSize];
+  memcpy(carried, elemAddr, h->elemSize);
+  void *placed = NULL;
+
+  int slot = home;
+  unsigned int probe = 1;
+  while (table->probeLengths[slot] != kEmptySlot) {
+    if (table->probeLengths[slot] < probe) {
+      void *resident = SlotAddress(h, table, slot);
+      if (placed == NULL) placed = resident;
+      memcpy(displaced, resident, h->elemSize);
+      memcpy(resident, carried, h->elemSize);
+      memcpy(carried, displaced, h->elemSize);
+      unsigned short residentProbe = table->probeLengths[slot];
+      table->probeLengths[slot] = probe;
+      probe = residentProbe;
+      if (h->cachesHashCodes) {
+	int residentHashCode = table->hashCodes[slot];
+	table->hashCodes[slot] = hashCode;
+	hashCode = residentHashCode;
+      }
+    }
+
+    if (++slot == table->numBuckets) slot = 0;
+    probe++;
+    assert(probe <= kMaxProbeLength);
+  }
+
+  memcpy(SlotAddress(h, table, slot), carried, h->elemSize);
+  table->probeLengths[slot] = probe;
+  if (h->cachesHashCodes)
+    table->hashCodes[slot] = hashCode;
+  return (placed != NULL) ? placed : SlotAddress(h, table, slot);
+}
+
+/**
+ * Searches one chaining bucket.  Without cached hash codes, that's
+ * exactly what VectorSearch does.  With them, records whose hash codes
+ * differ from ours are passed over without calling the comparator.
+ */
+
+static void *ChainFind(const hashset *h, const vector *chain, const void *elemAddr, int hashCode)
+{
+  if (!h->cachesHashCodes) {
+    int elemPosition = VectorSearch(chain, elemAddr, h->compareFn, 0, false);
+    return (elemPosition == kNotFound) ? NULL : VectorNth(chain, elemPosition);
+  }
+
+  for (int i = 0; i < VectorLength(chain); i++) {
+    void *record = VectorNth(chain, i);
+    if (StoredHashCode(h, record) == hashCode && h->compareFn(elemAddr, record) == 0)
+      return record;
+  }
+
+  return NULL;
+}
+
+static void *ChainAppend(const hashset *h, vector *chain, const void *elemAddr, int hashCode)
+{
+  if (!h->cachesHashCodes) {
+    VectorAppend(chain, elemAddr);
+    return VectorNth(chain, VectorLength(chain) - 1);
+  }
+
+  char record[h->recordSize];
+  memset(record, 0, h->recordSize);
+  memcpy(record, elemAddr, h->elemSize);
+  memcpy(record + h->hashCodeOffset, &hashCode, sizeof(int));
+  VectorAppend(chain, record);
+  return VectorNth(chain, VectorLength(chain) - 1);
+}
+
+/**
+ * Returns the address of the element in the specified table that matches
+ * the one at elemAddr, or NULL if there isn't one.  The bucket is the one
+ * the element hashes to within that table.
+ */
+
+static void *TableLookup(const hashset *h, const hashsetTable *table, const void *elemAddr,
+			 int hashCode, int bucket)
+{ 
+  if (h->engine == kHashSetOpenAddressing) {
+    int slot = OpenAddressingFind(h, table, elemAddr, hashCode, bucket);
+    return (slot == kNotFound) ? NULL : SlotAddress(h, table, slot);
+  }
+
+  if (table == &h->retiring && bucket < h->migrated)
+    return NULL; // already drained and disposed of
+  return ChainFind(h, &table->buckets[bucket], elemAddr, hashCode);
+}
+
+/**
+ * Empties the specified slot, and then shifts each of the elements that follow
+ * it in its cluster back one slot, one step closer to home, until reaching
+ * an empty slot or an element that's already at home.  The Robin Hood invariant
+ * is restored without leaving a tombstone behind.  In a retiring table, the
+ * slots before h->migrated have already been drained, and the shift stops
+ * short of them.
+ */
+
+static void OpenAddressingErase(hashset *h, hashsetTable *table, int slot)
+{
+  int firstLiveSlot = (table == &h->retiring) ? h->migrated : 0;
+  while (true) {
+    int next = (slot + 1 == table->numBuckets) ? 0 : slot + 1;
+    if (next < firstLiveSlot || table->probeLengths[next] <= 1) break;
+    memcpy(SlotAddress(h, table, slot), SlotAddress(h, table, next), h->elemSize);
+    table->probeLengths[slot] = table->probeLengths[next] - 1;
+    if (h->cachesHashCodes)
+      table->hashCodes[slot] = table->hashCodes[next];
+    slot = next;
+  }
+
+  table->probeLengths[slot] = kEmptySlot;
+}
+
+/**
+ * Removes the record at the specified position of a chaining bucket.  Order
+ * within a bucket doesn't matter, so the last record is moved into the hole,
+ * and nothing else has to budge.
+ */
+
+static void ChainErase(const hashset *h, vector *chain, int position)
+{
+  int last = VectorLength(chain) - 1;
+  if (position != last)
+    memcpy(VectorNth(chain, position), VectorNth(chain, last), h->recordSize);
+  VectorDelete(chain, last);
+}
+
+/**
+ * Removes the element matching the one at elemAddr from the specified table,
+ * levying the free function against it.  Returns true if there was such an
+ * element, and false otherwise.
+ */
+
+static bool TableRemove(hashset *h, hashsetTable *table, const void *elemAddr, int hashCode, int bucket)
+{
+  if (h->engine == kHashSetOpenAddressing) {
+    int slot = OpenAddressingFind(h, table, elemAddr, hashCode, bucket);
+    if (slot == kNotFound) return false;
+    if (h->freeFn != NULL) h->freeFn(SlotAddress(h, table, slot));
+    OpenAddressingErase(h, table, slot);
+    return true;
+  }
+
+  if (table == &h->retiring && bucket < h->migrated)
+    return false;
+  vector *chain = &table->buckets[bucket];
+  char *found = ChainFind(h, chain, elemAddr, hashCode);
+  if (found == NULL) return false;
+  if (h->freeFn != NULL) h->freeFn(found);
+  ChainErase(h, chain, (found - (char *) VectorNth(chain, 0)) / h->recordSize);
+  return true;
+}
+
+/**
+ * Adds the element at elemAddr to the specified table, which is known not
+ * to contain a match already, and returns the address of the stored copy.
+ */
+
+static void *TableInsert(hashset *h, hashsetTable *table, const void *elemAddr, int hashCode, int bucket)
+{
+  if (h->engine == kHashSetOpenAddressing)
+    return OpenAddressingPlace(h, table, elemAddr, hashCode, bucket);
+  return ChainAppend(h, &table->buckets[bucket], elemAddr, hashCode);
+}
+
+/**
+ * Carries the contents of the next numBuckets buckets (or slots) of the
+ * retiring table over to the current one, in order.  Once everything has
+ * been moved, the retiring table is released.
+ */
+
+static void MigrateSome(hashset *h, int numBuckets)
+{
+  hashsetTable *retiring = &h->retiring;
+  for (int i = 0; i < numBuckets && h->migrated < retiring->numBuckets; i++, h->migrated++) {
+    int bucket = h->migrated;
+    if (h->engine == kHashSetOpenAddressing) {
+      if (!SlotInUse(retiring, bucket)) continue;
+      void *elemAddr = SlotAddress(h, retiring, bucket);
+      int hashCode = h->cachesHashCodes ? retiring->hashCodes[bucket] : 0;
+      OpenAddressingPlace(h, &h->table, elemAddr, hashCode, findElemBucket(h, &h->table, elemAddr, hashCode));
+      h->retiringLength--;
+    } else {
+      vector *chain = &retiring->buckets[bucket];
+      for (int j = 0; j < VectorLength(chain); j++) {
+	void *record = VectorNth(chain, j);
+	int hashCode = h->cachesHashCodes ? StoredHashCode(h, record) : 0;
+	VectorAppend(&h->table.buckets[findElemBucket(h, &h->table, record, hashCode)], record);
+      }
+      h->retiringLength -= VectorLength(chain);
+      VectorDispose(chain);
+    }
+  }
+
+  if (h->migrated == retiring->numBuckets) {
+    assert(h->retiringLength == 0);
+    TableDispose(h, retiring, retiring->numBuckets);
+    retiring->numBuckets = 0;
+    h->migrated = 0;
+  }
+}
+
+/**
+ * Retires the current table in favor of a new, empty one with the
+ * specified number of buckets.  The elements stay where they are until
+ * MigrateSome carries them over.
+ */
+
+static void RetireTable(hashset *h, int numBuckets)
+{
+  if (Growing(h))
+    MigrateSome(h, INT_MAX);
+  h->retiring = h->table;
+  h->retiringLength = h->length;
+  h->migrated = 0;
+  TableNew(h, &h->table, numBuckets);
+}
+
+static void StartGrowing(hashset *h, int numBuckets)
+{
+  h->numRehashes++;
+  __atomic_add_fetch(&globalStats.numRehashes, 1, __ATOMIC_RELAXED);
+  RetireTable(h, numBuckets);
+}
+
+static bool NeedsToGrow(const hashset *h)
+{
+  long numInTable = h->length - h->retiringLength + 1;
+  return numInTable * 100 > (long) h->table.numBuckets * MaxLoadPercent(h);
+}
+
+void HashSetReserve(hashset *h, int numElements)
+{
+  assert(numElements >= 0);
+  long numBuckets = ((long) numElements * 100 / MaxLoadPercent(h) + 1) | 1;
+  assert(numBuckets <= INT_MAX);
+  if (numBuckets <= h->table.numBuckets) return;
+  StartGrowing(h, numBuckets);
+  MigrateSome(h, INT_MAX);
+}
+
+void HashSetCompact(hashset *h)
+{
+  if (Growing(h))
+    MigrateSome(h, INT_MAX);
+
+  // half the maximum load, so the next few insertions don't trigger growth right away
+  long numBuckets = ((long) h->length * 200 / MaxLoadPercent(h) + 1) | 1;
+  if (numBuckets < h->table.numBuckets) {
+    RetireTable(h, numBuckets);
+    MigrateSome(h, INT_MAX);
+  }
+
+  if (h->engine == kHashSetChaining)
+    for (int bucket = 0; bucket < h->table.numBuckets; bucket++)
+      VectorShrinkToFit(&h->table.buckets[bucket]);
+}
+
+static void *FindOrInsert(hashset *h, const void *elemAddr, int hashCode, bool *inserted)
+{
+  if (Growing(h))
+    MigrateSome(h, kBucketsMigratedPerEnter);
+
+  void *existing = NULL;
+  if (Growing(h))
+    existing = TableLookup(h, &h->retiring, elemAddr, hashCode, findElemBucket(h, &h->retiring, elemAddr, hashCode));
+  int bucket =  findElemBucket(h, &h->table, elemAddr, hashCode);
+  if (existing == NULL)
+    existing = TableLookup(h, &h->table, elemAddr, hashCode, bucket);
+
+  if (existing != NULL) {
+    if (inserted != NULL) *inserted = false;
+    return existing;
+  }
+
+  if (NeedsToGrow(h)) {
+    StartGrowing(h, 2 * h->table.numBuckets + 1);
+    bucket = findElemBucket(h, &h->table, elemAddr, hashCode);
+  }
+
+  void *stored = TableInsert(h, &h->table, elemAddr, hashCode, bucket);
+  h->length++;
+  if (inserted != NULL) *inserted = true;
+  return stored;
+}
+
+static void Enter(hashset *h, const void *elemAddr, int hashCode)
+{
+  bool inserted;
+  void *stored = FindOrInsert(h, elemAddr, hashCode, &inserted);
+  if (!inserted) {
+    if (h->freeFn != NULL)
+      h->freeFn(stored);
+    memcpy(stored, elemAddr, h->elemSize);
+  }
+}
+
 void HashSetEnter(hashset *h, const void *elemAddr)
 {
-  int bucket =  findElemBucket(h,elemAddr);
-  // printData(h);
-  
-  //if(VectorIsNull(&h->data[bucket]))
-  //  VectorNew(&h->data[bucket],h->elemSize,h->freeFn, 4);
-  
-    
-  int elemPosition = VectorSearch(&h->data[bucket], elemAddr, h->compareFn, 0, false);
+  Enter(h, elemAddr, HashCode(h, elemAddr));
+}
+
+void HashSetEnterWithHashCode(hashset *h, const void *elemAddr, int hashCode)
+{
+  Enter(h, elemAddr, SuppliedHashCode(h, elemAddr, hashCode));
+}
+
+void *HashSetFindOrInsert(hashset *h, const void *elemAddr, bool *inserted)
+{
+  return FindOrInsert(h, elemAddr, HashCode(h, elemAddr), inserted);
+}
+
+void *HashSetFindOrInsertWithHashCode(hashset *h, const void *elemAddr, int hashCode, bool *inserted)
+{
+  return FindOrInsert(h, elemAddr, SuppliedHashCode(h, elemAddr, hashCode), inserted);
+}
 
-  if(elemPosition!= kNotFound)
-    VectorReplace(&h->data[bucket], elemAddr,elemPosition );
-  else{ 
-    VectorAppend(&h->data[bucket], elemAddr);
-    h->length++;
+static void *Lookup(const hashset *h, const void *elemAddr, int hashCode)
+{ 
+  if (Growing(h)) {
+    void *found = TableLookup(h, &h->retiring, elemAddr, hashCode, findElemBucket(h, &h->retiring, elemAddr, hashCode));
+    if (found != NULL) return found;
   }
+
+  return TableLookup(h, &h->table, elemAddr, hashCode, findElemBucket(h, &h->table, elemAddr, hashCode));
 }
 
 void *HashSetLookup(const hashset *h, const void *elemAddr)
-{ 
-  int bucket =  findElemBucket(h,elemAddr);
-  //if(VectorIsNull(&h->data[bucket]))
-  //return NULL;
-  int elemPosition = VectorSearch(&h->data[bucket], elemAddr, h->compareFn, 0, false);
- 
- if(elemPosition !=  kNotFound)
-    return VectorNth(&h->data[bucket],elemPosition);
-  return NULL; 
+{
+  return Lookup(h, elemAddr, HashCode(h, elemAddr));
+}
+
+void *HashSetLookupWithHashCode(const hashset *h, const void *elemAddr, int hashCode)
+{
+  return Lookup(h, elemAddr, SuppliedHashCode(h, elemAddr, hashCode));
+}
+
+static bool Remove(hashset *h, const void *elemAddr, int hashCode)
+{
+  if (Growing(h))
+    MigrateSome(h, kBucketsMigratedPerEnter);
+
+  if (Growing(h) &&
+      TableRemove(h, &h->retiring, elemAddr, hashCode, findElemBucket(h, &h->retiring, elemAddr, hashCode))) {
+    h->retiringLength--;
+  } else if (!TableRemove(h, &h->table, elemAddr, hashCode, findElemBucket(h, &h->table, elemAddr, hashCode))) {
+    return false;
+  }
+
+  h->length--;
+  return true;
+}
+
+bool HashSetRemove(hashset *h, const void *elemAddr)
+{
+  return Remove(h, elemAddr, HashCode(h, elemAddr));
+}
+
+bool HashSetRemoveWithHashCode(hashset *h, const void *elemAddr, int hashCode)
+{
+  return Remove(h, elemAddr, SuppliedHashCode(h, elemAddr, hashCode));
+}
+
+/**
+ * With kHashSetOpenAddressing, the walk starts just past an empty slot (the
+ * load factor guarantees there is one) and wraps around to end on it.  Erasing
+ * a slot only ever shifts later slots of the same cluster back by one, and
+ * clusters never span an empty slot, so no element can be shifted from the
+ * part of the table yet to be visited into the part that's already behind us.
+ */
+
+void HashSetIterBegin(hashsetIterator *it, hashset *h)
+{
+  if (Growing(h))
+    MigrateSome(h, INT_MAX);
+
+  it->h = h;
+  it->start = 0;
+  it->step = 0;
+  it->position = 0;
+  it->current = NULL;
+  if (h->engine == kHashSetOpenAddressing) {
+    int empty = 0;
+    while (empty < h->table.numBuckets && SlotInUse(&h->table, empty)) empty++;
+    assert(empty < h->table.numBuckets);
+    it->start = (empty + 1) % h->table.numBuckets;
+  }
+}
+
+void *HashSetIterNext(hashsetIterator *it)
+{
+  hashset *h = it->h;
+  hashsetTable *table = &h->table;
+  it->current = NULL;
+  if (h->engine == kHashSetOpenAddressing) {
+    while (it->step < table->numBuckets) {
+      int slot = (it->start + it->step++) % table->numBuckets;
+      if (SlotInUse(table, slot))
+	return it->current = SlotAddress(h, table, slot);
+    }
+    return NULL;
+  }
+
+  while (it->step < table->numBuckets) {
+    vector *chain = &table->buckets[it->step];
+    if (it->position < VectorLength(chain))
+      return it->current = VectorNth(chain, it->position++);
+    it->step++;
+    it->position = 0;
+  }
+  return NULL;
+}
+
+void HashSetIterRemove(hashsetIterator *it)
+{
+  assert(it->current != NULL);
+  hashset *h = it->h;
+  hashsetTable *table = &h->table;
+  if (h->freeFn != NULL) h->freeFn(it->current);
+  if (h->engine == kHashSetOpenAddressing) {
+    int slot = (it->start + it->step - 1) % table->numBuckets;
+    OpenAddressingErase(h, table, slot);
+    if (SlotInUse(table, slot)) it->step--; // something was shifted in, and it hasn't been visited yet
+  } else {
+    ChainErase(h, &table->buckets[it->step], --it->position); // the last record moved in, if anything
+  }
+
+  h->length--;
+  it->current = NULL;
+}
+
+/**
+ * Adds the specified table's buckets (or slots), from firstBucket on,
+ * to the occupancy histogram and the other running totals.
+ */
+
+static void TableStats(const hashset *h, const hashsetTable *table, int firstBucket, hashsetStats *stats)
+{
+  int numCategories = sizeof(stats->occupancy) / sizeof(stats->occupancy[0]);
+  stats->bytesReserved += TableBytes(h, table);
+  for (int bucket = firstBucket; bucket < table->numBuckets; bucket++) {
+    int chainLength;
+    if (h->engine == kHashSetOpenAddressing) {
+      chainLength = table->probeLengths[bucket]; // 0 if empty, and otherwise 1 + the distance from home
+      if (chainLength > 0) {
+	int distance = chainLength - 1;
+	stats->occupancy[(distance < numCategories) ? distance : numCategories - 1]++;
+      }
+    } else {
+      vectorStats bucketStats;
+      VectorStats(&table->buckets[bucket], &bucketStats);
+      chainLength = bucketStats.length;
+      stats->bytesReserved += bucketStats.bytesReserved;
+      stats->occupancy[(chainLength < numCategories) ? chainLength : numCategories - 1]++;
+    }
 
+    if (chainLength == 0) stats->numEmptyBuckets++;
+    if (chainLength > stats->longestChain) stats->longestChain = chainLength;
+  }
+}
+
+void HashSetStats(const hashset *h, hashsetStats *stats)
+{
+  assert(stats != NULL);
+  memset(stats, 0, sizeof(hashsetStats));
+  stats->count = h->length;
+  stats->numBuckets = h->table.numBuckets;
+  stats->bytesUsed = (long) h->length * h->elemSize;
+  stats->numRehashes = h->numRehashes;
+  if (Growing(h))
+    TableStats(h, &h->retiring, h->migrated, stats);
+  TableStats(h, &h->table, 0, stats);
+}
+
+void HashSetGlobalStats(hashsetGlobalStats *stats)
+{
+  assert(stats != NULL);
+  stats->bytesReserved = __atomic_load_n(&globalStats.bytesReserved, __ATOMIC_RELAXED);
+  stats->peakBytesReserved = __atomic_load_n(&globalStats.peakBytesReserved, __ATOMIC_RELAXED);
+  stats->numRehashes = __atomic_load_n(&globalStats.numRehashes, __ATOMIC_RELAXED);
 }
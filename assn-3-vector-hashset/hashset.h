@@ -62,6 +62,44 @@ typedef void (*HashSetMapFunction)(void *elemAddr, void *auxData);
 
 typedef void (*HashSetFreeFunction)(void *elemAddr);
 
+/**
+ * Type: HashSetEngine
+ * -------------------
+ * Identifies the storage strategy used behind the hashset interface.
+ *
+ *   - kHashSetChaining partitions the elements into numBuckets vectors,
+ *     and a lookup searches the one vector the element hashes to.
+ *   - kHashSetOpenAddressing stores all of the elements in one contiguous
+ *     slab of slots, and resolves collisions by Robin Hood linear probing:
+ *     an element being placed evicts any resident element that sits closer
+ *     to its own home slot, so all probe sequences stay short and a lookup
+ *     can stop as soon as it passes the point where its key would have been
+ *     placed.
+ *
+ * Both engines implement exactly the same semantics; they differ only in
+ * memory layout and in how many pointers are chased per lookup.
+ */
+
+typedef enum {
+  kHashSetChaining,
+  kHashSetOpenAddressing
+} HashSetEngine;
+
+/**
+ * Type: hashsetTable
+ * ------------------
+ * One generation of a hashset's storage.  Which fields are in use
+ * depends on the engine.  Clients never deal with this type directly.
+ */
+
+typedef struct {
+  int numBuckets;
+  vector *buckets;              // chaining only: numBuckets vectors
+  char *slots;                  // open addressing only: numBuckets elements, back to back
+  unsigned short *probeLengths; // open addressing only: 0 if empty, else distance from home slot + 1
+  int *hashCodes;               // open addressing with cached hash codes only: one per slot
+} hashsetTable;
+
 /**
  * Type: hashset
  * -------------
@@ -74,14 +112,21 @@ typedef void (*HashSetFreeFunction)(void *elemAddr);
 
 typedef struct {
   int length;
-  vector *data;
-  int numBuckets;
+  hashsetTable table;
+  hashsetTable retiring; // previous generation, drained into table a few buckets at a time
+  int retiringLength;    // number of elements still living in retiring
+  int migrated;          // number of retiring buckets already drained
 
   HashSetCompareFunction compareFn;
   HashSetHashFunction hashFn;
-  //  int elemSize;
-  //HashSetFreeFunction freeFn;
-  // to be filled in by you
+  HashSetFreeFunction freeFn;
+  int elemSize;
+  HashSetEngine engine;
+  bool cachesHashCodes;
+  int recordSize;        // bytes per chaining bucket entry: the element, plus its hash code if cached
+  int hashCodeOffset;
+  int numRehashes;       // times the elements have been moved to a bigger table
+  const allocator *alloc; // NULL means malloc, realloc, and free
 } hashset;
 
 /**
@@ -97,9 +142,13 @@ typedef struct {
  * raised if this size is less than or equal to 0.
  *
  * The numBuckets parameter specifies the number of buckets that the elements
- * will be partitioned into.  Once a hashset is created, this number does
- * not change.  The numBuckets parameter must be in sync with the behavior of
- * the hashfn, which must return a hash code between 0 and numBuckets - 1.   
+ * will initially be partitioned into.  Once the average bucket holds more than
+ * two elements, the hashset switches over to a table with roughly twice as many
+ * buckets.  Elements aren't all rehashed at once; instead, every HashSetEnter
+ * carries a few of the old buckets over to the new table, so no single call
+ * pays for the entire rehash.  The numBuckets parameter must be in sync with
+ * the behavior of the hashfn, which must return a hash code between 0 and
+ * numBuckets - 1 for whatever numBuckets it is handed.
  * The hashfn parameter specifies the function that is called to retrieve the
  * hash code for a given element.  See the type declaration of HashSetHashFunction
  * above for more information.  An assert is raised if numBuckets is less than or
@@ -126,6 +175,94 @@ typedef struct {
 void HashSetNew(hashset *h, int elemSize, int numBuckets, 
 		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn);
 
+/**
+ * Function: HashSetNewUsingEngine
+ * -------------------------------
+ * Operates exactly the same as HashSetNew (which always uses kHashSetChaining),
+ * except that the client gets to choose the storage engine.  With
+ * kHashSetOpenAddressing, numBuckets is the initial number of slots, and the
+ * slab grows once 80% of its slots are taken.
+ *
+ * The same asserts raised by HashSetNew are raised here.
+ */
+
+void HashSetNewUsingEngine(hashset *h, int elemSize, int numBuckets,
+			   HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+			   HashSetFreeFunction freefn, HashSetEngine engine);
+
+/**
+ * Function: HashSetNewCachingHashCodes
+ * ------------------------------------
+ * Operates exactly the same as HashSetNewUsingEngine, except that the hashset
+ * stores each element's hash code right alongside the element.  Lookups then
+ * compare hash codes before they bother calling the compare function, and
+ * growing the hashset never calls the hash function again, which pays off
+ * handsomely when hashing is expensive (long string keys, for instance).
+ * Each element costs an extra int or so.
+ *
+ * The cached code is whatever the hash function returns when handed INT_MAX
+ * as its bucket count, and the bucket an element lands in is derived from that
+ * code.  That means the hash function should spread its codes over the full
+ * [0, INT_MAX) range, as any '% numBuckets' hash function naturally does.
+ *
+ * The same asserts raised by HashSetNew are raised here.
+ */
+
+void HashSetNewCachingHashCodes(hashset *h, int elemSize, int numBuckets,
+				HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+				HashSetFreeFunction freefn, HashSetEngine engine);
+
+/**
+ * Function: HashSetNewUsingAllocator
+ * ----------------------------------
+ * Operates exactly the same as HashSetNewUsingEngine, except that the hashset
+ * acquires all of its memory (the table, and with kHashSetChaining, every
+ * bucket) from the specified allocator rather than from the heap.  Passing
+ * NULL for alloc is the same as calling HashSetNewUsingEngine.  The
+ * allocator needs to outlive the hashset.
+ *
+ * A hashset whose allocator never releases anything (an arena, say) still
+ * works, but the tables left behind by growth are only reclaimed when the
+ * allocator's memory is, so it pays to size the hashset up front.
+ *
+ * The same asserts raised by HashSetNew are raised here.
+ */
+
+void HashSetNewUsingAllocator(hashset *h, int elemSize, int numBuckets,
+			      HashSetHashFunction hashfn, HashSetCompareFunction comparefn,
+			      HashSetFreeFunction freefn, HashSetEngine engine, const allocator *alloc);
+
+/**
+ * Function: HashSetReserve
+ * ------------------------
+ * Grows the hashset (if need be) so that it can hold numElements elements
+ * without ever having to grow again.  Clients who know roughly how many
+ * elements they're going to enter can call this right after HashSetNew
+ * and avoid all of the intermediate tables.  Unlike the incremental growth
+ * triggered by HashSetEnter, the rehash happens right away.  Addresses
+ * previously handed back by HashSetLookup are invalidated.
+ *
+ * An assert is raised if numElements is negative.
+ */
+
+void HashSetReserve(hashset *h, int numElements);
+
+/**
+ * Function: HashSetCompact
+ * ------------------------
+ * Gives back memory the hashset no longer needs.  A hashset never shrinks
+ * on its own, so one that was once much bigger (or that was reserved for
+ * far more elements than it ended up with) keeps its peak footprint until
+ * this is called.  Any growth in progress is finished, the elements are
+ * rehashed into a table sized for half the maximum load if that's smaller
+ * than the current one, and with kHashSetChaining, every bucket is trimmed
+ * to fit.  Runs in time proportional to the number of elements plus the
+ * number of buckets, and invalidates addresses previously handed back by
+ * HashSetLookup.
+ */
+
+void HashSetCompact(hashset *h);
+
 /**
  * Function: HashSetDispose
  * ------------------------
@@ -162,6 +299,10 @@ int HashSetCount(const hashset *h);
  * and compare functions are concerned), the the
  * old element is replaced by this new element.
  *
+ * Entering an element may move previously entered elements
+ * around in memory, so any addresses handed back by HashSetLookup
+ * should be considered invalid afterwards.
+ *
  * An assert is raised if the specified address is NULL, or
  * if the embedded hash function somehow computes a hash code
  * for the element that is out of the [0, numBuckets) range.
@@ -169,6 +310,35 @@ int HashSetCount(const hashset *h);
 
 void HashSetEnter(hashset *h, const void *elemAddr);
 
+/**
+ * Function: HashSetFindOrInsert
+ * -----------------------------
+ * Looks for a stored element matching the one at elemAddr, and enters
+ * a copy of it if there isn't one.  Either way, the address of the
+ * stored element is returned, and if inserted is non-NULL, *inserted is
+ * set to true if and only if the element was entered by this very call.
+ * Unlike HashSetEnter, an existing element is left alone (and the freefn
+ * isn't called), and the element is only hashed and searched for once,
+ * which makes this the right call for code that would otherwise call
+ * HashSetLookup, then HashSetEnter on a miss, and then HashSetLookup again.
+ *
+ * The client is free to update the stored element through the returned
+ * address, provided the update doesn't change how the element hashes or
+ * compares.  The address is not stable for the life of the element: it's
+ * only good until the hashset is next changed or walked.  Any of
+ * HashSetEnter, HashSetFindOrInsert, HashSetRemove, their WithHashCode
+ * variants, HashSetReserve, HashSetCompact, HashSetIterBegin and
+ * HashSetIterRemove might move the element (by migrating it out of a
+ * retiring table, displacing it to make room for another, reallocating
+ * its chain, or shifting it back into a vacated slot), so the address
+ * should be considered invalid after any of them.  HashSetLookup,
+ * HashSetMap, HashSetIterNext and HashSetStats never move anything.
+ *
+ * The same asserts raised by HashSetEnter are raised here.
+ */
+
+void *HashSetFindOrInsert(hashset *h, const void *elemAddr, bool *inserted);
+
 /**
  * Function: HashSetLookup
  * -----------------------
@@ -178,7 +348,8 @@ void HashSetEnter(hashset *h, const void *elemAddr);
  * If no match is found, then NULL is returned as a sentinel.
  * Understand that the key (residing at elemAddr) only needs
  * to match a stored element as far as the hash and compare
- * functions are concerned.
+ * functions are concerned.  The returned address is good for
+ * exactly as long as one returned by HashSetFindOrInsert.
  *
  * An assert is raised if the specified address is NULL, or
  * if the embedded hash function somehow computes a hash code
@@ -187,6 +358,80 @@ void HashSetEnter(hashset *h, const void *elemAddr);
 
 void *HashSetLookup(const hashset *h, const void *elemAddr);
 
+/**
+ * Function: HashSetRemove
+ * -----------------------
+ * Removes the element matching the one at elemAddr, if there is one, levying
+ * the free function against it first.  Returns true if and only if an element
+ * was removed.  With kHashSetOpenAddressing, the elements that follow in the
+ * removed element's cluster are shifted back a slot, so removals never leave
+ * tombstones behind and lookups stay every bit as fast as they were before.
+ * Either way, addresses previously handed back by HashSetLookup are invalidated.
+ *
+ * The same asserts raised by HashSetLookup are raised here.
+ */
+
+bool HashSetRemove(hashset *h, const void *elemAddr);
+
+/**
+ * Functions: HashSetEnterWithHashCode, HashSetFindOrInsertWithHashCode,
+ *            HashSetLookupWithHashCode, HashSetRemoveWithHashCode
+ * ------------------------------------------------------------------
+ * Operate exactly the same as the functions they're named after, except that
+ * the caller supplies the element's hash code (what the hash function returns
+ * when handed INT_MAX as its bucket count), so the hash function isn't called
+ * at all.  They're meant for clients that have to hash the element for reasons
+ * of their own anyway (the concurrenthashset, for instance, which uses the
+ * same code to pick a shard).
+ *
+ * An assert is raised unless the hashset was built by HashSetNewCachingHashCodes,
+ * and if hashCode is out of the [0, INT_MAX) range.  The other asserts raised
+ * by the functions they're named after are raised here, too.
+ */
+
+void HashSetEnterWithHashCode(hashset *h, const void *elemAddr, int hashCode);
+void *HashSetFindOrInsertWithHashCode(hashset *h, const void *elemAddr, int hashCode, bool *inserted);
+void *HashSetLookupWithHashCode(const hashset *h, const void *elemAddr, int hashCode);
+bool HashSetRemoveWithHashCode(hashset *h, const void *elemAddr, int hashCode);
+
+/**
+ * Type: hashsetIterator
+ * ---------------------
+ * Records how far a walk over the elements of a hashset has gotten.
+ * Clients never touch the fields directly.
+ */
+
+typedef struct {
+  hashset *h;
+  int start;      // open addressing only: the first slot visited, just past an empty one
+  int step;       // buckets (or slots) already left behind
+  int position;   // chaining only: elements of the current bucket already visited
+  void *current;  // element most recently handed back, or NULL once it's been removed
+} hashsetIterator;
+
+/**
+ * Functions: HashSetIterBegin, HashSetIterNext, HashSetIterRemove
+ * Usage: hashsetIterator it;
+ *        HashSetIterBegin(&it, &articles);
+ *        for (article *a; (a = HashSetIterNext(&it)) != NULL; )
+ *          if (a->expired) HashSetIterRemove(&it);
+ * ---------------------------------------------------------------
+ * Visits every element of the hashset exactly once, in no particular order.
+ * HashSetIterBegin readies the iterator (finishing off any growth in progress),
+ * and each call to HashSetIterNext hands back the address of the next element,
+ * or NULL once they've all been visited.  HashSetIterRemove removes the element
+ * most recently handed back (levying the free function against it), and the
+ * walk carries on without skipping or repeating any of the others.
+ *
+ * The hashset mustn't be changed by any other means until the walk is over.
+ * An assert is raised if HashSetIterRemove is called before the first call to
+ * HashSetIterNext, or twice for the same element.
+ */
+
+void HashSetIterBegin(hashsetIterator *it, hashset *h);
+void *HashSetIterNext(hashsetIterator *it);
+void HashSetIterRemove(hashsetIterator *it);
+
 /**
  * Function: HashSetMap
  * --------------------
@@ -203,5 +448,69 @@ void *HashSetLookup(const hashset *h, const void *elemAddr);
  */
 
 void HashSetMap(hashset *h, HashSetMapFunction mapfn, void *auxData);
+
+/**
+ * Type: hashsetStats
+ * ------------------
+ * Snapshot of how a hashset's elements are spread over its buckets and how
+ * much memory it's using, as filled in by HashSetStats.
+ *
+ * With kHashSetChaining, occupancy[n] is the number of buckets holding exactly
+ * n elements, and longestChain is the number of elements in the fullest bucket.
+ * With kHashSetOpenAddressing, occupancy[n] is the number of elements sitting
+ * exactly n slots past the slot they hash to, and longestChain is the most slots
+ * any lookup has to probe.  Either way, the last entry of occupancy lumps
+ * together everything from there on up.
+ */
+
+typedef struct {
+  int count;             // number of elements
+  int numBuckets;        // buckets (or slots) in the current table
+  int numEmptyBuckets;
+  int longestChain;
+  int occupancy[8];
+  long bytesUsed;        // count times the element size
+  long bytesReserved;    // heap memory held by the table(s), buckets included
+  int numRehashes;       // times the hashset has moved to a bigger table
+} hashsetStats;
+
+/**
+ * Function: HashSetStats
+ * ----------------------
+ * Fills in the hashsetStats record addressed by stats.  Every bucket is
+ * examined, so this runs in time proportional to the number of buckets.
+ * While the hashset is in the middle of growing, the buckets of the old
+ * table that haven't been carried over yet are included, too.
+ *
+ * Plenty of empty buckets alongside long chains points to a weak hash
+ * function; a large numRehashes suggests starting with more buckets
+ * (or calling HashSetReserve).
+ */
+
+void HashSetStats(const hashset *h, hashsetStats *stats);
+
+/**
+ * Type: hashsetGlobalStats
+ * ------------------------
+ * Memory accounting for the tables of every hashset in the program taken
+ * together, as filled in by HashSetGlobalStats.  Memory held by chaining
+ * buckets is accounted for by VectorGlobalStats instead, and tables carved
+ * from an allocator (see HashSetNewUsingAllocator) aren't counted at all.
+ */
+
+typedef struct {
+  long bytesReserved;      // heap memory currently held by all tables
+  long peakBytesReserved;  // the most heap memory ever held by all tables at once
+  long numRehashes;        // times any hashset moved to a bigger table
+} hashsetGlobalStats;
+
+/**
+ * Function: HashSetGlobalStats
+ * ----------------------------
+ * Fills in the hashsetGlobalStats record addressed by stats.  It's safe to
+ * call while other threads are using hashsets.
+ */
+
+void HashSetGlobalStats(hashsetGlobalStats *stats);
      
 #endif
@@ -134,16 +134,18 @@ static void AddFrequency(void *elem, void *v)
  * into a vector and sorts them by frequency of occurrences and 
  * prints the array out.  Note that this particular stress test passes
  * 0 as the initialAllocation, which the vector is required to handle
- * gracefully - be careful!
+ * gracefully - be careful!  The test is run once per storage engine, and
+ * since the engines only differ in layout, the two sorted listings
+ * should come out identical.
  */
-static void TestHashTable(void)
+static void TestHashTable(HashSetEngine engine, const char *engineName)
 {
   hashset counts;
   vector sortedCounts;
   
-  HashSetNew(&counts, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  HashSetNewUsingEngine(&counts, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL, engine);
   
-  fprintf(stdout, "\n\n ------------------------- Starting the HashTable test\n");
+  fprintf(stdout, "\n\n ------------------------- Starting the HashTable test (%s)\n", engineName);
   BuildTableOfLetterCounts(&counts);
   
   fprintf(stdout, "Here is the unordered contents of the table:\n");
@@ -163,9 +165,190 @@ static void TestHashTable(void)
   HashSetDispose(&counts);
 }
 
+/**
+ * Function: HashInt
+ * -----------------
+ * Hash function used for hashsets of ints.  Negative numbers
+ * never show up in the growth test, so a straight mod will do.
+ */
+
+static int HashInt(const void *elem, int numBuckets)
+{
+  return *(const int *)elem % numBuckets;
+}
+
+static int CompareInt(const void *elem1, const void *elem2)
+{
+  return *(const int *)elem1 - *(const int *)elem2;
+}
+
+/**
+ * Function: TestGrowth
+ * --------------------
+ * Starts a hashset off with a single bucket and then enters a large
+ * number of ints, so the hashset has to grow over and over again.  Every
+ * so often, all of the ints entered so far are looked up, which makes
+ * sure nothing gets lost while elements are being carried over from one
+ * table to the next.  A few ints are then entered a second time to make
+ * sure duplicates are still detected, and the test finishes by reserving
+ * enough space for twice as many ints and checking everything once more.
+ * The test is run with and without cached hash codes.
+ */
+
+static const int kNumGrowthInts = 100000;
+static void TestGrowth(HashSetEngine engine, bool cacheHashCodes, const char *description)
+{
+  hashset ints;
+  if (cacheHashCodes)
+    HashSetNewCachingHashCodes(&ints, sizeof(int), 1, HashInt, CompareInt, NULL, engine);
+  else
+    HashSetNewUsingEngine(&ints, sizeof(int), 1, HashInt, CompareInt, NULL, engine);
+  fprintf(stdout, "\n\n ------------------------- Starting the growth test (%s)\n", description);
+  
+  for (int i = 0; i < kNumGrowthInts; i++) {
+    HashSetEnter(&ints, &i);
+    if (i % 9973 == 0)
+      for (int j = 0; j <= i; j++)
+	assert(HashSetLookup(&ints, &j) != NULL);
+  }
+  
+  for (int i = 0; i < kNumGrowthInts; i += 7)
+    HashSetEnter(&ints, &i);
+  assert(HashSetCount(&ints) == kNumGrowthInts);
+  
+  HashSetReserve(&ints, 2 * kNumGrowthInts);
+  for (int i = 0; i < 2 * kNumGrowthInts; i++) {
+    int *found = HashSetLookup(&ints, &i);
+    assert((found != NULL) == (i < kNumGrowthInts));
+    assert(found == NULL || *found == i);
+  }
+  
+  int numInserted = 0;
+  for (int i = kNumGrowthInts / 2; i < 3 * kNumGrowthInts / 2; i++) {
+    bool inserted;
+    int *stored = HashSetFindOrInsert(&ints, &i, &inserted);
+    assert(inserted == (i >= kNumGrowthInts));
+    assert(*stored == i && stored == HashSetLookup(&ints, &i));
+    if (inserted) numInserted++;
+  }
+  assert(HashSetCount(&ints) == kNumGrowthInts + numInserted);
+  
+  hashsetStats stats, reserved;
+  HashSetReserve(&ints, 8 * kNumGrowthInts);
+  HashSetStats(&ints, &reserved);
+  HashSetCompact(&ints);
+  HashSetStats(&ints, &stats);
+  assert(stats.numBuckets < reserved.numBuckets && stats.bytesReserved < reserved.bytesReserved);
+  for (int i = 0; i < 3 * kNumGrowthInts / 2; i++)
+    assert(*(int *) HashSetLookup(&ints, &i) == i);
+  int numTallied = 0, numCategories = sizeof(stats.occupancy) / sizeof(stats.occupancy[0]);
+  for (int i = 0; i < numCategories; i++)
+    numTallied += (engine == kHashSetChaining) ? stats.occupancy[i] : 0;
+  assert(stats.count == HashSetCount(&ints));
+  assert(stats.bytesUsed == (long) stats.count * sizeof(int));
+  assert(stats.bytesReserved >= stats.bytesUsed);
+  assert(stats.numRehashes > 0);
+  assert(engine == kHashSetOpenAddressing || stats.occupancy[0] == stats.numEmptyBuckets);
+  assert(engine == kHashSetOpenAddressing || numTallied >= stats.numBuckets);
+  
+  fprintf(stdout, "Entered %d ints one at a time, and all of them are still there.\n", HashSetCount(&ints));
+  fprintf(stdout, "%d buckets (%d empty), longest chain %d, %d rehashes, %ld of %ld bytes in use.\n",
+	  stats.numBuckets, stats.numEmptyBuckets, stats.longestChain, stats.numRehashes,
+	  stats.bytesUsed, stats.bytesReserved);
+  HashSetDispose(&ints);
+}
+
+/**
+ * Function: HashClumpedInt
+ * ------------------------
+ * Deliberately poor hash function that sends runs of four consecutive
+ * ints to the same bucket, so that open addressing builds up clusters
+ * and removals have plenty of elements to shift back.  The runs themselves
+ * are scattered, so the clusters don't all run together.
+ */
+
+static int HashClumpedInt(const void *elem, int numBuckets)
+{
+  return (unsigned int) (*(const int *)elem / 4) * 2654435761u % numBuckets;
+}
+
+static int numIntsFreed = 0;
+static void CountFreedInt(void *elem)
+{
+  numIntsFreed++;
+}
+
+/**
+ * Function: TestRemoval
+ * ---------------------
+ * Enters a large number of ints into a hashset that starts off with a single
+ * bucket, removing every third one shortly after it's entered, so plenty of the
+ * removals hit a hashset that's in the middle of growing.  It then walks the
+ * hashset with an iterator, removing every even int along the way, and makes
+ * sure that every element was visited exactly once, that exactly the right
+ * elements survived, and that the free function was levied against every
+ * element removed.
+ */
+
+static const int kNumRemovalInts = 60000;
+static void TestRemoval(HashSetEngine engine, bool cacheHashCodes, const char *description)
+{
+  hashset ints;
+  if (cacheHashCodes)
+    HashSetNewCachingHashCodes(&ints, sizeof(int), 1, HashClumpedInt, CompareInt, CountFreedInt, engine);
+  else
+    HashSetNewUsingEngine(&ints, sizeof(int), 1, HashClumpedInt, CompareInt, CountFreedInt, engine);
+  fprintf(stdout, "\n\n ------------------------- Starting the removal test (%s)\n", description);
+
+  numIntsFreed = 0;
+  for (int i = 0; i < kNumRemovalInts; i++) {
+    HashSetEnter(&ints, &i);
+    if (i % 3 == 2) {
+      int doomed = i - 1;
+      bool removed = HashSetRemove(&ints, &doomed);
+      assert(removed);
+      removed = HashSetRemove(&ints, &doomed);
+      assert(!removed);
+    }
+  }
+
+  int numSurvivors = kNumRemovalInts - kNumRemovalInts / 3;
+  assert(HashSetCount(&ints) == numSurvivors && numIntsFreed == kNumRemovalInts / 3);
+  for (int i = 0; i < kNumRemovalInts; i++)
+    assert((HashSetLookup(&ints, &i) != NULL) == (i % 3 != 1));
+
+  char *visited = calloc(kNumRemovalInts, sizeof(char));
+  hashsetIterator it;
+  int numVisited = 0;
+  HashSetIterBegin(&it, &ints);
+  for (int *elem; (elem = HashSetIterNext(&it)) != NULL; numVisited++) {
+    assert(*elem % 3 != 1 && !visited[*elem]);
+    visited[*elem] = true;
+    if (*elem % 2 == 0) HashSetIterRemove(&it);
+  }
+
+  assert(numVisited == numSurvivors);
+  for (int i = 0; i < kNumRemovalInts; i++)
+    assert((HashSetLookup(&ints, &i) != NULL) == (i % 3 != 1 && i % 2 != 0));
+  assert(HashSetCount(&ints) + numIntsFreed == kNumRemovalInts);
+
+  fprintf(stdout, "Removed %d of %d ints, one at a time and mid-iteration, and the other %d are all still there.\n",
+	  numIntsFreed, kNumRemovalInts, HashSetCount(&ints));
+  free(visited);
+  HashSetDispose(&ints);
+}
+
 int main(int ununsed, char **alsoUnused) 
 {
-  TestHashTable();	
+  TestHashTable(kHashSetChaining, "chaining");
+  TestHashTable(kHashSetOpenAddressing, "open addressing");
+  TestGrowth(kHashSetChaining, false, "chaining");
+  TestGrowth(kHashSetOpenAddressing, false, "open addressing");
+  TestGrowth(kHashSetChaining, true, "chaining, cached hash codes");
+  TestGrowth(kHashSetOpenAddressing, true, "open addressing, cached hash codes");
+  TestRemoval(kHashSetChaining, false, "chaining");
+  TestRemoval(kHashSetOpenAddressing, false, "open addressing");
+  TestRemoval(kHashSetOpenAddressing, true, "open addressing, cached hash codes");
   return 0;
 }
 
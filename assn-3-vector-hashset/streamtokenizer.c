@@ -3,89 +3,462 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
-void STNew(streamtokenizer *st, FILE *infile, const char *delimiters, bool discardDelimiters)
+static const int kInitialBufferSize = 1 << 16;
+
+/**
+ * Fills in a 256-entry membership table for the specified character set,
+ * so that classifying a character costs a single array access rather than
+ * a call to strchr.  strchr reports the terminating '\0' as a member of
+ * every set, and the table follows suit so nothing changes for inputs with
+ * embedded '\0's.  The distinct members are listed as well, unless there
+ * are more than kMaxListedMembers of them.
+ */
+
+static void BuildCharacterSet(characterSet *set, const char *charSet)
+{
+  assert(charSet != NULL);
+  memset(set->contains, false, sizeof(set->contains));
+  set->contains[0] = true;
+  set->members[0] = '\0';
+  set->numMembers = 1;
+  for (const unsigned char *c = (const unsigned char *) charSet; *c != '\0'; c++) {
+    if (set->contains[*c]) continue;
+    set->contains[*c] = true;
+    if (set->numMembers == 0) continue;
+    if (set->numMembers == kMaxListedMembers) set->numMembers = 0;
+    else set->members[set->numMembers++] = *c;
+  }
+}
+
+/**
+ * Returns the address of the first character in [next, end) whose membership
+ * in the set is member, or end if there isn't one, classifying one character
+ * at a time through the table.
+ */
+
+static const char *FindByMembershipInTable(const char *next, const char *end, const characterSet *set, bool member)
+{
+  while (next < end && set->contains[(unsigned char) *next] != member) next++;
+  return next;
+}
+
+/**
+ * The block scans behind FindByMembershipInBlocks: each compares 32 (AVX2) or
+ * 16 (SSE2) characters at a time against every listed member of the set, and
+ * leaves whatever's left over to the table.  The AVX2 scan is compiled for
+ * AVX2 on its own, whatever the rest of the file is compiled for, so the
+ * default build has it and picks it at run time on processors that can run it.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static const char *FindByMembershipAVX2(const char *next, const char *end, const characterSet *set, bool member)
+{
+  __m256i needles[kMaxListedMembers];
+  for (int i = 0; i < set->numMembers; i++)
+    needles[i] = _mm256_set1_epi8(set->members[i]);
+  unsigned int flip = member ? 0 : 0xFFFFFFFFu;
+  for (; end - next >= 32; next += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *) next);
+    __m256i matches = _mm256_cmpeq_epi8(block, needles[0]);
+    for (int i = 1; i < set->numMembers; i++)
+      matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block, needles[i]));
+    unsigned int found = (unsigned int) _mm256_movemask_epi8(matches) ^ flip;
+    if (found != 0) return next + __builtin_ctz(found);
+  }
+  return FindByMembershipInTable(next, end, set, member);
+}
+#endif
+
+#if defined(__SSE2__)
+static const char *FindByMembershipSSE2(const char *next, const char *end, const characterSet *set, bool member)
+{
+  __m128i needles[kMaxListedMembers];
+  for (int i = 0; i < set->numMembers; i++)
+    needles[i] = _mm_set1_epi8(set->members[i]);
+  unsigned int flip = member ? 0 : 0xFFFFu;
+  for (; end - next >= 16; next += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *) next);
+    __m128i matches = _mm_cmpeq_epi8(block, needles[0]);
+    for (int i = 1; i < set->numMembers; i++)
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, needles[i]));
+    unsigned int found = (unsigned int) _mm_movemask_epi8(matches) ^ flip;
+    if (found != 0) return next + __builtin_ctz(found);
+  }
+  return FindByMembershipInTable(next, end, set, member);
+}
+#endif
+
+/**
+ * Returns the address of the first character in [next, end) whose membership
+ * in the set is member, or end if there isn't one.  Sets small enough to list
+ * are scanned in blocks, with AVX2 if the processor supports it (the check is
+ * no more than a test of a flag the runtime sets at startup) and with SSE2
+ * otherwise.  Sets too big to list, and builds for processors with neither
+ * instruction set, go through the table.
+ */
+
+static const char *FindByMembershipInBlocks(const char *next, const char *end, const characterSet *set, bool member)
+{
+  if (set->numMembers > 0) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) return FindByMembershipAVX2(next, end, set, member);
+#endif
+#if defined(__SSE2__)
+    return FindByMembershipSSE2(next, end, set, member);
+#endif
+  }
+  return FindByMembershipInTable(next, end, set, member);
+}
+
+/**
+ * Same as FindByMembershipInBlocks, except that the first kScalarPrefix
+ * characters are classified through the table.  Most tokens and most runs of
+ * delimiters are shorter than that, and they're found without paying to set
+ * up the block comparisons.
+ */
+
+static const int kScalarPrefix = 16;
+static inline const char *FindByMembership(const char *next, const char *end, const characterSet *set, bool member)
+{
+  const char *prefixEnd = (end - next > kScalarPrefix) ? next + kScalarPrefix : end;
+  while (next < prefixEnd && set->contains[(unsigned char) *next] != member) next++;
+  if (next < prefixEnd || next == end) return next;
+  return FindByMembershipInBlocks(next, end, set, member);
+}
+
+/**
+ * Sets up everything but the source, which is left for the constructors to
+ * fill in: no stream, no reader, and no buffer.
+ */
+
+static void Initialize(streamtokenizer *st, const char *delimiters, bool discardDelimiters)
 {
-  assert(infile != NULL);
   assert(delimiters != NULL);
   assert(strlen(delimiters) > 0);
-  
-  st->infile = infile;
+
+  st->infile = NULL;
+  st->reader = NULL;
+  st->source = NULL;
   st->discardDelimiters = discardDelimiters;
   st->delimiters = strdup(delimiters);
+  BuildCharacterSet(&st->delimiterSet, delimiters);
+  st->buffer = st->cursor = st->end = NULL;
+  st->bufferKind = kSTBufferOwned;
+  st->bufferSize = 0;
+  st->atEOF = false;
+  st->error = 0;
+}
+
+void STNew(streamtokenizer *st, FILE *infile, const char *delimiters, bool discardDelimiters)
+{
+  assert(infile != NULL);
+  Initialize(st, delimiters, discardDelimiters);
+  st->infile = infile;
+}
+
+/**
+ * The readers behind STNewBuffered and STNewFromDescriptor.  A descriptor
+ * is smuggled through the void * rather than pointed to, so there's nothing
+ * to allocate or release on its behalf.  fread returns 0 on failure as well
+ * as at the end of the stream, so ferror is what tells the two apart.
+ */
+
+static int ReadFromStream(void *source, char *buffer, int bufferLength)
+{
+  size_t numRead = fread(buffer, 1, bufferLength, source);
+  if (numRead == 0 && ferror((FILE *) source)) {
+    if (errno == 0) errno = EIO;
+    return -1;
+  }
+  return numRead;
+}
+
+static int ReadFromDescriptor(void *source, char *buffer, int bufferLength)
+{
+  int fd = (int) (intptr_t) source;
+  while (true) {
+    ssize_t numRead = read(fd, buffer, bufferLength);
+    if (numRead >= 0 || errno != EINTR) return numRead;
+  }
+}
+
+void STNewFromReader(streamtokenizer *st, STReadFunction reader, void *source,
+		     const char *delimiters, bool discardDelimiters)
+{
+  assert(reader != NULL);
+  Initialize(st, delimiters, discardDelimiters);
+  st->reader = reader;
+  st->source = source;
+  st->bufferSize = kInitialBufferSize;
+  st->buffer = malloc(st->bufferSize);
+  assert(st->buffer != NULL);
+  st->cursor = st->end = st->buffer;
+}
+
+void STNewBuffered(streamtokenizer *st, FILE *infile, const char *delimiters, bool discardDelimiters)
+{
+  assert(infile != NULL);
+  STNewFromReader(st, ReadFromStream, infile, delimiters, discardDelimiters);
+}
+
+void STNewFromDescriptor(streamtokenizer *st, int fd, const char *delimiters, bool discardDelimiters)
+{
+  assert(fd >= 0);
+  STNewFromReader(st, ReadFromDescriptor, (void *) (intptr_t) fd, delimiters, discardDelimiters);
+}
+
+/**
+ * Text that's already in memory becomes the buffer, and since there's
+ * nothing more to read, the streamtokenizer starts out at EOF as far as
+ * Refill is concerned.  The buffer is never written to.
+ */
+
+static void UseWholeText(streamtokenizer *st, char *text, int length, STBufferKind kind)
+{
+  st->buffer = st->cursor = text;
+  st->end = text + length;
+  st->bufferSize = length;
+  st->bufferKind = kind;
+  st->atEOF = true;
+}
+
+void STNewFromMemory(streamtokenizer *st, const char *text, int length, const char *delimiters, bool discardDelimiters)
+{
+  assert(text != NULL);
+  assert(length >= 0);
+  Initialize(st, delimiters, discardDelimiters);
+  UseWholeText(st, (char *) text, length, kSTBufferBorrowed);
+}
+
+/**
+ * Only regular files are mapped.  An empty one can't be mapped at all,
+ * and gets a zero-length buffer that's never dereferenced instead.
+ */
+
+bool STNewFromMappedFile(streamtokenizer *st, const char *path, const char *delimiters, bool discardDelimiters)
+{
+  assert(path != NULL);
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) return false;
+
+  struct stat info;
+  static char empty[1];
+  char *contents = MAP_FAILED;
+  if (fstat(fd, &info) == -1) {
+    info.st_size = 0;
+  } else if (!S_ISREG(info.st_mode)) {
+    errno = ENODEV; // pipes and terminals can't be mapped, and report no size to map
+  } else if (info.st_size > INT_MAX) {
+    errno = EFBIG;
+  } else if (info.st_size == 0) {
+    contents = empty;
+  } else {
+    contents = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (contents != MAP_FAILED) madvise(contents, info.st_size, MADV_SEQUENTIAL);
+  }
+
+  int reason = errno;
+  close(fd); // the mapping, if there is one, outlives the descriptor
+  errno = reason;
+  if (contents == MAP_FAILED) return false;
+
+  Initialize(st, delimiters, discardDelimiters);
+  UseWholeText(st, contents, info.st_size, kSTBufferMapped);
+  return true;
 }
 
 void STDispose(streamtokenizer *st)
 {
   free((void *) st->delimiters);  // donates the memory allocated by strdup back to the heap
+  if (st->bufferKind == kSTBufferOwned)
+    free(st->buffer);
+  else if (st->bufferKind == kSTBufferMapped && st->bufferSize > 0)
+    munmap(st->buffer, st->bufferSize);
 }
 
-bool STNextToken(streamtokenizer *st, char buffer[], int bufferLength)
+/**
+ * Slides the characters not yet handed out down to the front of the buffer,
+ * doubling the buffer first if they already fill it, and then has the reader
+ * pull as much from the source as fits behind them.  Returns true if anything
+ * new was read, and false once the source is exhausted.  Addresses into the
+ * buffer don't survive the call, though offsets from st->cursor do.
+ */
+
+static bool Refill(streamtokenizer *st)
 {
-	return STNextTokenUsingDifferentDelimiters(st, buffer, bufferLength, st->delimiters);
+  if (st->atEOF) return false;
+  int numUnread = st->end - st->cursor;
+  memmove(st->buffer, st->cursor, numUnread);
+  if (numUnread == st->bufferSize) {
+    assert(st->bufferSize <= INT_MAX / 2);
+    st->bufferSize *= 2;
+    st->buffer = realloc(st->buffer, st->bufferSize);
+    assert(st->buffer != NULL);
+  }
+
+  st->cursor = st->buffer;
+  st->end = st->buffer + numUnread;
+  errno = 0;
+  int numRead = st->reader(st->source, st->end, st->bufferSize - numUnread);
+  if (numRead <= 0) {
+    if (numRead < 0) st->error = (errno != 0) ? errno : EIO;
+    st->atEOF = true;
+    return false;
+  }
+
+  st->end += numRead;
+  return true;
 }
 
-bool STNextTokenUsingDifferentDelimiters(streamtokenizer *st, char buffer[], int bufferLength, const char *delimiters)
+/**
+ * Skips past characters whose membership in the specified set matches
+ * skipping, and returns the first character that doesn't (leaving it
+ * unread), or EOF.  This is the one place the unbuffered streamtokenizer
+ * pays for a getc call per character.
+ */
+
+static int SkipHelper(streamtokenizer *st, const characterSet *set, bool skipping)
+{
+  if (st->buffer == NULL) {
+    int next;
+    while (true) {
+      next = getc(st->infile);
+      if (next == EOF) return EOF;
+      if (set->contains[next] != skipping) break;
+    }
+
+    ungetc(next, st->infile);
+    return next;
+  }
+
+  while (true) {
+    const char *next = FindByMembership(st->cursor, st->end, set, !skipping);
+    st->cursor = (char *) next;
+    if (next < st->end) return (unsigned char) *next;
+    if (!Refill(st)) return EOF;
+  }
+}
+
+/**
+ * Scans the next token of a buffered streamtokenizer without copying it.
+ * Tokens longer than maxLength are chopped, and the remainder is left for
+ * next time, just as STNextToken does with tokens that overflow the client's
+ * buffer.
+ */
+
+static bool NextTokenBuffered(streamtokenizer *st, const characterSet *delimiterSet, int maxLength,
+			      const char **token, int *length)
+{
+  if (st->discardDelimiters) SkipHelper(st, delimiterSet, true);
+  if (st->cursor == st->end && !Refill(st)) return false;
+
+  int scanned = 1; // a delimiter is a token all by itself
+  if (!delimiterSet->contains[(unsigned char) *st->cursor]) {
+    while (true) {
+      const char *limit = (st->end - st->cursor > maxLength) ? st->cursor + maxLength : st->end;
+      const char *next = FindByMembership(st->cursor + scanned, limit, delimiterSet, true);
+      scanned = next - st->cursor;
+      if (next < st->end || scanned == maxLength || !Refill(st)) break;
+    }
+  }
+
+  *token = st->cursor;
+  *length = scanned;
+  st->cursor += scanned;
+  return true;
+}
+
+static bool NextToken(streamtokenizer *st, char buffer[], int bufferLength, const characterSet *delimiterSet)
 {
   int i;
   int next;
-  
+
   assert(buffer != NULL);
   assert(bufferLength >= 2);
-  
-  if (st->discardDelimiters) STSkipOver(st, delimiters);
+
+  if (st->buffer != NULL) {
+    const char *token;
+    int length;
+    if (!NextTokenBuffered(st, delimiterSet, bufferLength - 1, &token, &length)) return false;
+    memcpy(buffer, token, length);
+    buffer[length] = '\0';
+    return true;
+  }
+
+  if (st->discardDelimiters) SkipHelper(st, delimiterSet, true);
   next = getc(st->infile);
   if (next == EOF) return false;
   buffer[0] = next;
-  if (strchr(delimiters, next) != NULL) {
+  if (delimiterSet->contains[next]) {
     buffer[1] = '\0';
     return true;
   }
-  
+
   // pull characters until hit stop character, or until buffer is full
   for (i = 1; i < bufferLength - 1; i++) { // leave room for '\0'
     next = fgetc(st->infile);
     if (next == EOF) break;
-    if (strchr(delimiters, next) != NULL) {
+    if (delimiterSet->contains[next]) {
       ungetc(next, st->infile);
       break;
     }
-    
-    buffer[i] = next; 
+
+    buffer[i] = next;
   }
-  
+
   // i indexes place where null-term should be placed...
   buffer[i] = '\0';
   return true;
 }
 
-static bool HaveReasonToStop(const char *charSet, int next, bool skipping)
+bool STNextToken(streamtokenizer *st, char buffer[], int bufferLength)
 {
-  bool inSet = (strchr(charSet, next) != NULL);
-  return ((inSet && !skipping) || (!inSet && skipping));
+  return NextToken(st, buffer, bufferLength, &st->delimiterSet);
 }
 
-static int STSkipHelper(streamtokenizer *st, const char *charSet, bool skipping)
+bool STNextTokenUsingDifferentDelimiters(streamtokenizer *st, char buffer[], int bufferLength, const char *delimiters)
 {
-  int next;
-  
-  while (true) {
-    next = getc(st->infile);
-    if (next == EOF) return EOF;
-    if (HaveReasonToStop(charSet, next, skipping)) break;
-  }
-  
-  ungetc(next, st->infile); 
-  return next;
+  characterSet delimiterSet;
+  BuildCharacterSet(&delimiterSet, delimiters);
+  return NextToken(st, buffer, bufferLength, &delimiterSet);
+}
+
+bool STNextTokenView(streamtokenizer *st, const char **token, int *length)
+{
+  assert(st->buffer != NULL);
+  assert(token != NULL && length != NULL);
+  return NextTokenBuffered(st, &st->delimiterSet, INT_MAX, token, length);
 }
 
 int STSkipUntil(streamtokenizer *st, const char *skipUntilSet)
 {
-  return STSkipHelper(st, skipUntilSet, false);
+  characterSet stopSet;
+  BuildCharacterSet(&stopSet, skipUntilSet);
+  return SkipHelper(st, &stopSet, false);
 }
 
 int STSkipOver(streamtokenizer *st, const char *skipSet)
 {
-  return STSkipHelper(st, skipSet, true);
+  characterSet skippedSet;
+  BuildCharacterSet(&skippedSet, skipSet);
+  return SkipHelper(st, &skippedSet, true);
+}
+
+int STError(const streamtokenizer *st)
+{
+  if (st->error == 0 && st->infile != NULL && ferror(st->infile)) return EIO;
+  return st->error;
 }
@@ -30,17 +30,73 @@
  * It could do anything at all with the token that populates the client-supplied
  * character buffer called word.
  *
- * Note that the client should not at all access the three fields of
+ * Note that the client should not at all access the fields of
  * streamtokenizer directly.  The only reason you see them here is because
  * there's no easy way to hide them in C.  You should pretend that they've
  * been marked as private.  Let the implementations of all the streamtokenizer
  * functions manage the fields for you.
  */
 
+/**
+ * Type: characterSet
+ * ------------------
+ * The form in which the streamtokenizer keeps a set of delimiters or skip
+ * characters: a membership table for classifying characters one at a time,
+ * plus, when the set is small enough, the members themselves, so that the
+ * buffered scans can compare a whole block of characters against each member
+ * at once.  Like the fields of streamtokenizer, it's private.
+ */
+
+#define kMaxListedMembers 8
+
+typedef struct {
+  bool contains[256];     // indexed by unsigned char
+  int numMembers;         // how many of members are filled in, or 0 if the set is too big to list
+  unsigned char members[kMaxListedMembers];
+} characterSet;
+
+/**
+ * Type: STReadFunction
+ * --------------------
+ * The signature of a function that a buffered streamtokenizer calls on to
+ * refill its buffer.  It should copy up to bufferLength bytes from the
+ * source into buffer and return how many it copied, blocking until it can
+ * supply at least one.  It returns 0 once the source is exhausted, and a
+ * negative number (with errno set to say why) if reading fails.  Either
+ * way, the streamtokenizer stops reading, but a failure is also recorded
+ * for STError to report.  The source is whatever the client passed to
+ * STNewFromReader, and is handed back untouched.
+ */
+
+typedef int (*STReadFunction)(void *source, char *buffer, int bufferLength);
+
+/**
+ * Type: STBufferKind
+ * ------------------
+ * Records who owns the streamtokenizer's buffer, so that STDispose knows
+ * whether to free it, unmap it, or leave it alone.
+ */
+
+typedef enum {
+  kSTBufferOwned,         // allocated by the streamtokenizer, and refilled by its reader
+  kSTBufferMapped,        // a memory-mapped file
+  kSTBufferBorrowed       // client memory passed to STNewFromMemory
+} STBufferKind;
+
 typedef struct {
-  FILE *infile;
+  FILE *infile;           // NULL unless the streamtokenizer reads one character at a time
+  STReadFunction reader;  // refills an owned buffer
+  void *source;           // passed to reader
   const char *delimiters;
   bool discardDelimiters;
+  characterSet delimiterSet; // built from delimiters once and for all
+  char *buffer;           // NULL unless the streamtokenizer reads ahead (see STNewBuffered)
+  STBufferKind bufferKind;
+  char *cursor;           // next character of buffer not yet handed out
+  char *end;              // one past the last character read into buffer
+  int bufferSize;
+  bool atEOF;             // true once the source has nothing more to give
+  int error;              // the errno of the read that failed, or 0 if none has
 } streamtokenizer;
 
 /**
@@ -66,13 +122,101 @@ typedef struct {
 
 void STNew(streamtokenizer *st, FILE *infile, const char *delimiters, bool discardDelimiters);
 
+/**
+ * Function: STNewBuffered
+ * -----------------------
+ * Operates exactly the same as STNew, except that the streamtokenizer
+ * reads the stream in large blocks into a buffer of its own rather than
+ * one character at a time, which is many times faster on big inputs.  The
+ * price is that the streamtokenizer reads ahead of the tokens it hands out,
+ * so the stream shouldn't be read by any other means while the streamtokenizer
+ * is in use (and whatever it read ahead is gone once it's disposed of).  It's
+ * the right choice whenever the streamtokenizer is going to consume the whole
+ * stream, and the wrong one for interactive input, since filling the buffer
+ * waits on either a full block or the end of the stream.
+ *
+ * Only a buffered streamtokenizer supports STNextTokenView.
+ *
+ * The same asserts raised by STNew are raised here.
+ */
+
+void STNewBuffered(streamtokenizer *st, FILE *infile, const char *delimiters, bool discardDelimiters);
+
+/**
+ * Function: STNewFromMappedFile
+ * -----------------------------
+ * Initializes the specified streamtokenizer to tokenize the named file, which
+ * is mapped into memory in its entirety rather than read.  There's no FILE *,
+ * no stdio locking, and no copying into a buffer: tokens are scanned right out
+ * of the mapping, so local files are tokenized about as fast as memory can be
+ * read.  Otherwise, the streamtokenizer behaves exactly like one created by
+ * STNewBuffered, except that the views handed back by STNextTokenView stay
+ * valid until the streamtokenizer is disposed of.
+ *
+ * Returns true if the file was mapped, and false (leaving the streamtokenizer
+ * uninitialized) if it couldn't be opened or isn't a regular file that can be
+ * mapped, in which case errno says why.
+ *
+ * The same asserts raised by STNew are raised here, plus one if path is NULL.
+ */
+
+bool STNewFromMappedFile(streamtokenizer *st, const char *path, const char *delimiters, bool discardDelimiters);
+
+/**
+ * Function: STNewFromMemory
+ * -------------------------
+ * Initializes the specified streamtokenizer to tokenize the length characters
+ * starting at text, which needn't be '\0'-terminated.  The text is neither
+ * copied nor modified, so it must stay put until the streamtokenizer is
+ * disposed of, and the views handed back by STNextTokenView point right into
+ * it.  Otherwise, the streamtokenizer behaves exactly like a buffered one.
+ *
+ * The same asserts raised by STNew are raised here, plus ones if text
+ * is NULL or length is negative.
+ */
+
+void STNewFromMemory(streamtokenizer *st, const char *text, int length, const char *delimiters, bool discardDelimiters);
+
+/**
+ * Function: STNewFromDescriptor
+ * -----------------------------
+ * Initializes the specified streamtokenizer to tokenize everything that can
+ * be read from the specified file descriptor, be it a file, a pipe, or a
+ * socket.  Input is pulled with read(2) straight into the streamtokenizer's
+ * own buffer, so there's no stdio layer and no stream locking involved.
+ * Otherwise, the streamtokenizer behaves exactly like one created by
+ * STNewBuffered: it reads ahead, and it doesn't close the descriptor.
+ *
+ * The same asserts raised by STNew are raised here, plus one if fd is negative.
+ */
+
+void STNewFromDescriptor(streamtokenizer *st, int fd, const char *delimiters, bool discardDelimiters);
+
+/**
+ * Function: STNewFromReader
+ * -------------------------
+ * Initializes the specified streamtokenizer to tokenize whatever the specified
+ * reader pulls out of source (see STReadFunction), which is how a client plugs
+ * in a source of its own: a decompressor, a TLS connection, or a chain of
+ * in-memory blocks, say.  The streamtokenizer calls reader whenever its buffer
+ * runs dry, and otherwise behaves exactly like one created by STNewBuffered.
+ * It's up to the client to release whatever source refers to, after the
+ * streamtokenizer has been disposed of.
+ *
+ * The same asserts raised by STNew are raised here, plus one if reader is NULL.
+ */
+
+void STNewFromReader(streamtokenizer *st, STReadFunction reader, void *source,
+		     const char *delimiters, bool discardDelimiters);
+
 /**
  * Function: STDispose
  * -------------------
  * Properly disposes of any resources acquired by
  * STNew.  The FILE * passed to STInitialize is 
  * *not* closed, because STInitialize didn't open any
- * files.
+ * files, and neither is a descriptor passed to STNewFromDescriptor.
+ * A file mapped by STNewFromMappedFile is unmapped.
  */
 
 void STDispose(streamtokenizer *st);
@@ -145,6 +289,26 @@ bool STNextToken(streamtokenizer *st, char buffer[], int bufferLength);
 bool STNextTokenUsingDifferentDelimiters(streamtokenizer *st, char buffer[], int bufferLength,
 										 const char *delimiters);
 
+/**
+ * Function: STNextTokenView
+ * Usage: const char *word;
+ *        int length;
+ *        while (STNextTokenView(&st, &word, &length))
+ *          printf("%.*s\n", length, word);
+ * -------------------------
+ * Operates the same as STNextToken, save for the fact that nothing is
+ * copied: the address of the token's first character is placed in *token
+ * and its length in *length.  The characters live in the streamtokenizer's
+ * own buffer and aren't null-terminated, and they're only good until the next
+ * call to any of the streamtokenizer functions.  Tokens are never chopped into
+ * pieces, however long they are, since the buffer grows to fit them.
+ *
+ * An assert is raised if the streamtokenizer was created by STNew (which reads
+ * one character at a time and has no buffer), or if either token or length is NULL.
+ */
+
+bool STNextTokenView(streamtokenizer *st, const char **token, int *length);
+
 /**
  * Function: STSkipOver
  * --------------------
@@ -197,4 +361,19 @@ int STSkipOver(streamtokenizer *st, const char *skipSet);
 
 int STSkipUntil(streamtokenizer *st, const char *skipUntilSet);
 
+/**
+ * Function: STError
+ * -----------------
+ * Tells a clean end of input apart from one brought on by a failed read.
+ * Once STNextToken (or any of its relatives) reports that there's nothing
+ * left, STError returns 0 if the source really was exhausted, and the errno
+ * of the read that failed otherwise: a pipe or socket that broke mid-stream,
+ * say.  The error is sticky, so it's still reported however many calls
+ * later the client asks.  Reads interrupted by a signal are retried, and
+ * never count as failures.  An unbuffered streamtokenizer (see STNew) can
+ * only go by ferror, and reports EIO if its stream has failed.
+ */
+
+int STError(const streamtokenizer *st);
+
 #endif
@@ -0,0 +1,313 @@
+#include "streamtokenizer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/**
+ * Function: WriteSampleText
+ * -------------------------
+ * Fills the named temporary file with pseudo-random text: short words drawn
+ * from a small alphabet, runs of delimiters, the occasional '\0', and a handful
+ * of tokens far longer than the buffered streamtokenizer's initial buffer, so
+ * that tokens straddle buffer boundaries and the buffer has to grow.
+ */
+
+static const char *const kSampleDelimiters = " ,\n";
+static const int kNumSampleChunks = 200000;
+static void WriteSampleText(char path[])
+{
+  FILE *sample = fdopen(mkstemp(path), "w");
+  assert(sample != NULL);
+  srand(107);
+  for (int i = 0; i < kNumSampleChunks; i++) {
+    int length = (i % 40000 == 39999) ? 150000 : rand() % 12;
+    for (int j = 0; j < length; j++)
+      fputc("abcde<>\"!"[rand() % 9], sample);
+    fputc(kSampleDelimiters[rand() % 3], sample);
+    if (rand() % 1000 == 0) fputc('\0', sample);
+  }
+
+  fclose(sample);
+}
+
+/**
+ * Type: sampleSource
+ * ------------------
+ * The different places a buffered streamtokenizer can draw the sample text
+ * from.  The trickle reader hands the text over a few bytes at a time, so
+ * that nearly every token straddles a refill.
+ */
+
+typedef enum {
+  kFromStream, kFromMappedFile, kFromMemory, kFromDescriptor, kFromTrickle
+} sampleSource;
+
+static const char *const kSourceNames[] = { "buffered", "mapped", "in-memory", "descriptor", "trickle-fed" };
+
+static int ReadTrickle(void *source, char *buffer, int bufferLength)
+{
+  int length = rand() % 7 + 1;
+  return fread(buffer, 1, (length < bufferLength) ? length : bufferLength, source);
+}
+
+/**
+ * Function: OpenSample
+ * --------------------
+ * Initializes st to tokenize the sample text from the specified kind of
+ * source.  Whatever has to be released once st is disposed of (a stream, a
+ * descriptor, or a copy of the text) is recorded in the remaining arguments.
+ */
+
+static void OpenSample(streamtokenizer *st, const char *path, sampleSource source, bool discardDelimiters,
+		       FILE **stream, int *fd, char **text)
+{
+  *stream = NULL;
+  *fd = -1;
+  *text = NULL;
+  if (source == kFromMappedFile) {
+    bool mapped = STNewFromMappedFile(st, path, kSampleDelimiters, discardDelimiters);
+    assert(mapped);
+  } else if (source == kFromDescriptor) {
+    *fd = open(path, O_RDONLY);
+    assert(*fd != -1);
+    STNewFromDescriptor(st, *fd, kSampleDelimiters, discardDelimiters);
+  } else {
+    *stream = fopen(path, "r");
+    assert(*stream != NULL);
+    if (source == kFromStream) {
+      STNewBuffered(st, *stream, kSampleDelimiters, discardDelimiters);
+    } else if (source == kFromTrickle) {
+      STNewFromReader(st, ReadTrickle, *stream, kSampleDelimiters, discardDelimiters);
+    } else {
+      fseek(*stream, 0, SEEK_END);
+      long length = ftell(*stream);
+      rewind(*stream);
+      *text = malloc(length);
+      assert(*text != NULL);
+      size_t numRead = fread(*text, 1, length, *stream);
+      assert(numRead == (size_t) length);
+      STNewFromMemory(st, *text, length, kSampleDelimiters, discardDelimiters);
+    }
+  }
+}
+
+static void CloseSample(streamtokenizer *st, FILE *stream, int fd, char *text)
+{
+  STDispose(st);
+  if (stream != NULL) fclose(stream);
+  if (fd != -1) close(fd);
+  free(text);
+}
+
+/**
+ * Function: TestBufferedMatchesUnbuffered
+ * ---------------------------------------
+ * Runs a buffered and an unbuffered streamtokenizer side by side over the
+ * same text, with the delimiters discarded and kept, a cycling set of client
+ * buffer sizes (so long tokens get chopped at different places), and skip
+ * calls mixed in, and confirms that the two agree on every single result.
+ * The buffered streamtokenizer draws the text from the specified source.
+ */
+
+static void TestBufferedMatchesUnbuffered(const char *path, bool discardDelimiters, sampleSource source)
+{
+  static char expected[200000], actual[200000];
+  const int bufferLengths[] = { 2, 7, 64, 1024, sizeof(expected) };
+  const int numBufferLengths = sizeof(bufferLengths) / sizeof(bufferLengths[0]);
+  streamtokenizer plain, buffered;
+  FILE *sample = fopen(path, "r"), *copy;
+  int fd;
+  char *text;
+  assert(sample != NULL);
+
+  fprintf(stdout, " ------------------------- Starting the %s tokenizer test (delimiters %s)\n",
+	  kSourceNames[source], discardDelimiters ? "discarded" : "kept");
+  STNew(&plain, sample, kSampleDelimiters, discardDelimiters);
+  OpenSample(&buffered, path, source, discardDelimiters, &copy, &fd, &text);
+  long numTokens = 0;
+  for (int i = 0; true; i++) {
+    if (i % 1000 == 999) {
+      int expectedNext = STSkipUntil(&plain, "e"), actualNext = STSkipUntil(&buffered, "e");
+      assert(expectedNext == actualNext);
+      expectedNext = STSkipOver(&plain, "e<>");
+      actualNext = STSkipOver(&buffered, "e<>");
+      assert(expectedNext == actualNext);
+    }
+    if (i % 5000 == 4999) { // too many characters for the block scans, so they fall back on the table
+      int expectedNext = STSkipOver(&plain, "abcd<>\"! ,\n");
+      int actualNext = STSkipOver(&buffered, "abcd<>\"! ,\n");
+      assert(expectedNext == actualNext);
+    }
+
+    int bufferLength = bufferLengths[i % numBufferLengths];
+    bool more = (i % 3 == 0) ?
+      STNextTokenUsingDifferentDelimiters(&plain, expected, bufferLength, "\n") :
+      STNextToken(&plain, expected, bufferLength);
+    bool actualMore = (i % 3 == 0) ?
+      STNextTokenUsingDifferentDelimiters(&buffered, actual, bufferLength, "\n") :
+      STNextToken(&buffered, actual, bufferLength);
+    assert(more == actualMore);
+    if (!more) break;
+    assert(strcmp(expected, actual) == 0);
+    numTokens++;
+  }
+
+  int error = STError(&buffered);
+  assert(error == 0);
+  fprintf(stdout, "Both tokenizers agreed on all %ld tokens.\n", numTokens);
+  STDispose(&plain);
+  fclose(sample);
+  CloseSample(&buffered, copy, fd, text);
+}
+
+/**
+ * Function: TestTokenViews
+ * ------------------------
+ * Pulls every token out of the text as a view and confirms that the views
+ * match what STNextToken produces and that no token is ever chopped, however
+ * long it is.
+ */
+
+static void TestTokenViews(const char *path)
+{
+  static char expected[200000];
+  streamtokenizer plain, viewed;
+  FILE *sample = fopen(path, "r"), *copy = fopen(path, "r");
+  assert(sample != NULL && copy != NULL);
+
+  fprintf(stdout, " ------------------------- Starting the token view test\n");
+  STNew(&plain, sample, kSampleDelimiters, true);
+  STNewBuffered(&viewed, copy, kSampleDelimiters, true);
+  const char *token;
+  int length, longest = 0;
+  while (STNextTokenView(&viewed, &token, &length)) {
+    bool found = STNextToken(&plain, expected, sizeof(expected));
+    assert(found);
+    assert(length == (int) strlen(expected) && memcmp(token, expected, length) == 0);
+    if (length > longest) longest = length;
+  }
+
+  bool more = STNextToken(&plain, expected, sizeof(expected));
+  assert(!more);
+  fprintf(stdout, "Every view matched, and the longest token came back whole (%d characters).\n", longest);
+  STDispose(&plain);
+  STDispose(&viewed);
+  fclose(sample);
+  fclose(copy);
+}
+
+/**
+ * Function: TestMappedEdgeCases
+ * -----------------------------
+ * Confirms that missing files and files that aren't regular files are reported
+ * rather than asserted on, and that an empty file (which can't actually be mapped) simply has no tokens.
+ */
+
+static void TestMappedEdgeCases(void)
+{
+  streamtokenizer st;
+  char buffer[16];
+  const char *token;
+  int length;
+
+  fprintf(stdout, " ------------------------- Starting the mapped edge case test\n");
+  bool opened = STNewFromMappedFile(&st, "/nonexistent/streamtokenizertest", kSampleDelimiters, true);
+  assert(!opened);
+  opened = STNewFromMappedFile(&st, "/dev/null", kSampleDelimiters, true);
+  assert(!opened);
+
+  char path[] = "/tmp/streamtokenizertest-empty-XXXXXX";
+  close(mkstemp(path));
+  opened = STNewFromMappedFile(&st, path, kSampleDelimiters, true);
+  assert(opened);
+  int next = STSkipUntil(&st, "a");
+  assert(next == EOF);
+  bool more = STNextTokenView(&st, &token, &length);
+  assert(!more);
+  more = STNextToken(&st, buffer, sizeof(buffer));
+  assert(!more);
+  STDispose(&st);
+  unlink(path);
+  fprintf(stdout, "Missing, unmappable, and empty files were handled.\n");
+}
+
+/**
+ * Function: TestReadErrors
+ * ------------------------
+ * Confirms that a read that fails partway through ends the input just as
+ * exhausting it would, but that STError reports the failure, while a source
+ * that simply runs dry reports no error at all.  The failing reader hands
+ * over a couple of tokens before pretending the connection was reset, and a
+ * directory stands in for a descriptor that can't be read.
+ */
+
+static int ReadThenFail(void *source, char *buffer, int bufferLength)
+{
+  int *numCalls = source;
+  if ((*numCalls)++ > 0) {
+    errno = ECONNRESET;
+    return -1;
+  }
+  memcpy(buffer, "one two ", 8);
+  return 8;
+}
+
+static void TestReadErrors(void)
+{
+  streamtokenizer st;
+  char buffer[16];
+
+  fprintf(stdout, " ------------------------- Starting the read error test\n");
+  int numCalls = 0;
+  STNewFromReader(&st, ReadThenFail, &numCalls, kSampleDelimiters, true);
+  int numTokens = 0;
+  while (STNextToken(&st, buffer, sizeof(buffer))) numTokens++;
+  assert(numTokens == 2);
+  int error = STError(&st);
+  assert(error == ECONNRESET);
+  bool more = STNextToken(&st, buffer, sizeof(buffer));
+  assert(!more);
+  error = STError(&st);
+  assert(error == ECONNRESET);
+  STDispose(&st);
+
+  int fd = open("/tmp", O_RDONLY);
+  assert(fd != -1);
+  STNewFromDescriptor(&st, fd, kSampleDelimiters, true);
+  more = STNextToken(&st, buffer, sizeof(buffer));
+  assert(!more);
+  error = STError(&st);
+  assert(error == EISDIR);
+  STDispose(&st);
+  close(fd);
+
+  fd = open("/dev/null", O_RDONLY);
+  assert(fd != -1);
+  STNewFromDescriptor(&st, fd, kSampleDelimiters, true);
+  more = STNextToken(&st, buffer, sizeof(buffer));
+  assert(!more);
+  error = STError(&st);
+  assert(error == 0);
+  STDispose(&st);
+  close(fd);
+  fprintf(stdout, "Failed reads were reported, and a clean end of input wasn't.\n");
+}
+
+int main(int ununsed, char **alsoUnused)
+{
+  char path[] = "/tmp/streamtokenizertest-XXXXXX";
+  WriteSampleText(path);
+  for (sampleSource source = kFromStream; source <= kFromTrickle; source++) {
+    TestBufferedMatchesUnbuffered(path, true, source);
+    TestBufferedMatchesUnbuffered(path, false, source);
+  }
+  TestTokenViews(path);
+  TestMappedEdgeCases();
+  TestReadErrors();
+  unlink(path);
+  return 0;
+}
@@ -0,0 +1,65 @@
+#include "stringpool.h"
+#include <string.h>
+#include <assert.h>
+
+/**
+ * Case-sensitive version of the linear congruence hash used throughout
+ * the assignments.  elem is really a const char ** in disguise.
+ */
+
+static const signed long kHashMultiplier = -1664117991L;
+static int CanonicalStringHash(const void *elem, int numBuckets)
+{
+  unsigned long hashcode = 0;
+  const char *s = *(const char **) elem;
+
+  for (int i = 0; s[i] != '\0'; i++)
+    hashcode = hashcode * kHashMultiplier + (unsigned char) s[i];
+
+  return hashcode % numBuckets;
+}
+
+static int CanonicalStringCompare(const void *elem1, const void *elem2)
+{
+  const char *s1 = *(const char **) elem1;
+  const char *s2 = *(const char **) elem2;
+  return strcmp(s1, s2);
+}
+
+void StringPoolNew(stringpool *pool, int numBuckets)
+{
+  ArenaNew(&pool->storage, 0);
+  HashSetNewCachingHashCodes(&pool->strings, sizeof(const char *), numBuckets,
+			     CanonicalStringHash, CanonicalStringCompare, NULL, kHashSetOpenAddressing);
+  pool->numBytes = 0;
+}
+
+void StringPoolDispose(stringpool *pool)
+{
+  HashSetDispose(&pool->strings);
+  ArenaDispose(&pool->storage);
+}
+
+const char *StringPoolIntern(stringpool *pool, const char *s)
+{
+  assert(s != NULL);
+  bool inserted;
+  const char **canonical = HashSetFindOrInsert(&pool->strings, &s, &inserted);
+  if (inserted) {
+    // the new element still addresses the client's string, so swap in a copy
+    *canonical = ArenaStrdup(&pool->storage, s);
+    pool->numBytes += strlen(s) + 1;
+  }
+
+  return *canonical;
+}
+
+int StringPoolCount(const stringpool *pool)
+{
+  return HashSetCount(&pool->strings);
+}
+
+int StringPoolNumBytes(const stringpool *pool)
+{
+  return pool->numBytes;
+}
@@ -0,0 +1,87 @@
+#ifndef _stringpool_
+#define _stringpool_
+#include "arena.h"
+#include "hashset.h"
+
+/* File: stringpool.h
+ * ------------------
+ * Defines the interface for the stringpool, which interns C strings.
+ *
+ * Interning a string hands back the pool's one canonical copy of it,
+ * so two strings interned in the same pool are equal if and only if
+ * their addresses are equal.  The canonical copies are packed one
+ * after another into an arena, and are all released together when
+ * the pool itself is disposed of.
+ *
+ * Like the vector and the hashset, the stringpool does no locking
+ * of its own; clients sharing a pool between threads need to
+ * serialize access to it themselves.
+ */
+
+/**
+ * Type: stringpool
+ * ----------------
+ * The concrete representation of the stringpool.  The fields are
+ * exposed, but clients should only interact with a stringpool via
+ * the functions below.
+ */
+
+typedef struct {
+  arena storage;       // where the canonical copies live
+  hashset strings;     // const char *s, each addressing a canonical copy
+  int numBytes;        // total size of the canonical copies, '\0's included
+} stringpool;
+
+/**
+ * Function: StringPoolNew
+ * -----------------------
+ * Initializes the identified stringpool to be empty.  numBuckets is the
+ * initial size of the pool's hashset, which grows as needed.
+ *
+ * An assert is raised if numBuckets is less than or equal to 0.
+ */
+
+void StringPoolNew(stringpool *pool, int numBuckets);
+
+/**
+ * Function: StringPoolDispose
+ * ---------------------------
+ * Releases every canonical copy the pool has ever handed out, all
+ * at once.  None of the addresses returned by StringPoolIntern should
+ * be dereferenced after this is called.
+ */
+
+void StringPoolDispose(stringpool *pool);
+
+/**
+ * Function: StringPoolIntern
+ * --------------------------
+ * Returns the address of the pool's canonical copy of the specified
+ * C string, copying it into the pool if this is the first time it's
+ * been seen.  The comparison is case-sensitive, so "Apple" and "apple"
+ * have different canonical copies.  The returned string is good for
+ * as long as the pool is, and must never be freed or modified.
+ *
+ * An assert is raised if s is NULL.
+ */
+
+const char *StringPoolIntern(stringpool *pool, const char *s);
+
+/**
+ * Function: StringPoolCount
+ * -------------------------
+ * Returns the number of distinct strings interned so far.
+ */
+
+int StringPoolCount(const stringpool *pool);
+
+/**
+ * Function: StringPoolNumBytes
+ * ----------------------------
+ * Returns the number of bytes occupied by the canonical copies,
+ * including their '\0' terminators.
+ */
+
+int StringPoolNumBytes(const stringpool *pool);
+
+#endif
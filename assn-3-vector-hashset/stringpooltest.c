@@ -0,0 +1,186 @@
+#include "stringpool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * Function: TestArena
+ * -------------------
+ * Carves a mix of small, oddly sized, and oversized blocks out of an arena
+ * with tiny chunks, scribbles over every one of them, and then confirms that
+ * every block is aligned and that none of them overlap.
+ */
+
+static const int kNumBlocks = 1000;
+static void TestArena(void)
+{
+  arena a;
+  char *blocks[kNumBlocks];
+  int sizes[kNumBlocks];
+
+  fprintf(stdout, " ------------------------- Starting the arena test\n");
+  ArenaNew(&a, 256);
+  for (int i = 0; i < kNumBlocks; i++) {
+    sizes[i] = (i % 10 == 0) ? 1000 : i % 37;
+    blocks[i] = ArenaAllocate(&a, sizes[i]);
+    assert((unsigned long) blocks[i] % (2 * sizeof(void *)) == 0);
+    memset(blocks[i], i % 256, sizes[i]);
+  }
+
+  for (int i = 0; i < kNumBlocks; i++)
+    for (int j = 0; j < sizes[i]; j++)
+      assert((unsigned char) blocks[i][j] == i % 256);
+
+  const char *word = ArenaStrdup(&a, "arena");
+  assert(strcmp(word, "arena") == 0);
+  fprintf(stdout, "Allocated %d blocks from %d chunks, and none of them overlap.\n",
+	  kNumBlocks, ArenaNumChunks(&a));
+  ArenaDispose(&a);
+}
+
+static int HashInt(const void *elem, int numBuckets)
+{
+  return *(const int *) elem % numBuckets;
+}
+
+static int CompareInt(const void *elem1, const void *elem2)
+{
+  return *(const int *) elem1 - *(const int *) elem2;
+}
+
+/**
+ * Function: TestArenaAllocator
+ * ----------------------------
+ * Builds a vector and a hashset of each engine entirely inside an arena,
+ * radix sorts the vector (whose scratch buffer comes from the arena too),
+ * confirms that everything made it in and that none of it was counted as
+ * heap memory, and then throws the whole lot away by disposing of the
+ * arena alone.  Run under a leak checker, this shows
+ * that nothing was left on the heap.
+ */
+
+static const int kNumArenaInts = 50000;
+static void TestArenaAllocator(void)
+{
+  arena a;
+  allocator alloc;
+  vector ints;
+  hashset chained, addressed;
+  vectorGlobalStats vectorsBefore, vectorsAfter;
+  hashsetGlobalStats hashsetsBefore, hashsetsAfter;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the arena allocator test\n");
+  VectorGlobalStats(&vectorsBefore);
+  HashSetGlobalStats(&hashsetsBefore);
+  ArenaNew(&a, 0);
+  ArenaAllocatorNew(&alloc, &a);
+  VectorNewUsingAllocator(&ints, sizeof(int), NULL, 0, &alloc);
+  HashSetNewUsingAllocator(&chained, sizeof(int), 1, HashInt, CompareInt, NULL, kHashSetChaining, &alloc);
+  HashSetNewUsingAllocator(&addressed, sizeof(int), 1, HashInt, CompareInt, NULL, kHashSetOpenAddressing, &alloc);
+  for (int i = 0; i < kNumArenaInts; i++) {
+    int reversed = kNumArenaInts - 1 - i;
+    VectorAppend(&ints, &reversed);
+    HashSetEnter(&chained, &i);
+    HashSetEnter(&addressed, &i);
+  }
+
+  VectorSortIntegers(&ints);
+  for (int i = 0; i < kNumArenaInts; i++) {
+    assert(*(int *) VectorNth(&ints, i) == i);
+    assert(*(int *) HashSetLookup(&chained, &i) == i);
+    assert(*(int *) HashSetLookup(&addressed, &i) == i);
+  }
+
+  VectorGlobalStats(&vectorsAfter);
+  HashSetGlobalStats(&hashsetsAfter);
+  assert(vectorsAfter.bytesReserved == vectorsBefore.bytesReserved);
+  assert(vectorsAfter.numAllocations == vectorsBefore.numAllocations);
+  assert(vectorsAfter.numFrees == vectorsBefore.numFrees);
+  assert(hashsetsAfter.bytesReserved == hashsetsBefore.bytesReserved);
+  fprintf(stdout, "Entered %d ints into a vector and two hashsets carved from %d arena chunks.\n",
+	  kNumArenaInts, ArenaNumChunks(&a));
+  ArenaDispose(&a);
+}
+
+/**
+ * Function: TestInterning
+ * -----------------------
+ * Interns every word of a small passage twice, the second time from a
+ * freshly built copy, and confirms that equal words always come back as
+ * the very same pointer and that unequal words never do.
+ */
+
+static void TestInterning(void)
+{
+  const char *passage[] = { "the", "quick", "brown", "fox", "jumps", "over", "the",
+			    "lazy", "dog", "and", "The", "DOG", "sleeps", "", "fox" };
+  int numWords = sizeof(passage) / sizeof(passage[0]);
+  const char *canonical[numWords];
+  stringpool pool;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the interning test\n");
+  StringPoolNew(&pool, 1);
+  for (int i = 0; i < numWords; i++) {
+    canonical[i] = StringPoolIntern(&pool, passage[i]);
+    assert(canonical[i] != passage[i] && strcmp(canonical[i], passage[i]) == 0);
+  }
+
+  for (int i = 0; i < numWords; i++) {
+    char copy[strlen(passage[i]) + 1];
+    strcpy(copy, passage[i]);
+    const char *interned = StringPoolIntern(&pool, copy);
+    assert(interned == canonical[i]);
+    for (int j = 0; j < numWords; j++)
+      assert((canonical[i] == canonical[j]) == (strcmp(passage[i], passage[j]) == 0));
+  }
+
+  assert(StringPoolCount(&pool) == 13);
+  fprintf(stdout, "Interned %d words as %d distinct strings occupying %d bytes.\n",
+	  numWords, StringPoolCount(&pool), StringPoolNumBytes(&pool));
+  StringPoolDispose(&pool);
+}
+
+/**
+ * Function: TestManyStrings
+ * -------------------------
+ * Interns enough distinct strings to force the pool's hashset to grow
+ * several times over, and then checks that every one of them still maps
+ * to the same canonical copy.
+ */
+
+static const int kNumStrings = 50000;
+static void TestManyStrings(void)
+{
+  stringpool pool;
+  const char **canonical = malloc(kNumStrings * sizeof(const char *));
+  char buffer[32];
+
+  fprintf(stdout, "\n\n ------------------------- Starting the many strings test\n");
+  StringPoolNew(&pool, 16);
+  for (int i = 0; i < kNumStrings; i++) {
+    sprintf(buffer, "string-%d", i);
+    canonical[i] = StringPoolIntern(&pool, buffer);
+  }
+
+  for (int i = 0; i < kNumStrings; i++) {
+    sprintf(buffer, "string-%d", i);
+    const char *interned = StringPoolIntern(&pool, buffer);
+    assert(interned == canonical[i]);
+    assert(strcmp(canonical[i], buffer) == 0);
+  }
+
+  assert(StringPoolCount(&pool) == kNumStrings);
+  fprintf(stdout, "All %d strings kept their canonical copies.\n", StringPoolCount(&pool));
+  free(canonical);
+  StringPoolDispose(&pool);
+}
+
+int main(int ununsed, char **alsoUnused)
+{
+  TestArena();
+  TestArenaAllocator();
+  TestInterning();
+  TestManyStrings();
+  return 0;
+}
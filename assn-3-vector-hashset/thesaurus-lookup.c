@@ -2,22 +2,34 @@
 #include "hashset.h"
 #include "vector.h"
 #include "streamtokenizer.h"
+#include "threadpool.h"
 #include <stdlib.h>  // for malloc, free, etc
 #include <string.h>  // for strcmp
 #include <strings.h>
 #include <ctype.h>   // for tolower
-#include <time.h>    // for time
+#include <assert.h>
+#include <time.h>    // for time, clock_gettime
+#include <fcntl.h>   // for open
+#include <unistd.h>  // for close
+#include <stdint.h>  // for uint32_t
+#include <errno.h>
+#include <limits.h>  // for INT_MAX
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /**
- * Convenience struct used to bundle a word (expressed 
- * as a dynamically allocated C string) with the list
- * of all of its synonyms (stored in a C vector of
- * dynamically allocated C strings).
+ * Convenience struct used to bundle a word with the list
+ * of all of its synonyms.  Everything an entry refers to
+ * lives in a single dynamically allocated block: the array
+ * of synonym pointers comes first (which is why synonyms
+ * addresses the block), followed by the characters of the
+ * word and of every synonym, each null-terminated.
  */
 
 typedef struct {
   char *word;
-  vector synonyms;
+  int numSynonyms;
+  char **synonyms;
 } thesaurusEntry;
 
 /**
@@ -37,7 +49,7 @@ static int StringHash(const void *elem, int numBuckets)
 {
   char *s = *(char **) elem;
   unsigned long hashcode = 0;
-  for (int i = 0; i < strlen(s); i++)  
+  for (int i = 0; s[i] != '\0'; i++)  
     hashcode = hashcode * kHashMultiplier + tolower(s[i]);  
   return hashcode % numBuckets;                                  
 }
@@ -63,9 +75,9 @@ static int StringCompare(const void *elem1, const void *elem2)
 
 /**
  * Properly disposes of the thesaurusEntry understood to
- * sit at the specified address.  Note that the synonyms
- * vector already knows how to dispose of all of its strings,
- * so the call to VectorDispose is sufficient.
+ * sit at the specified address.  The word and all of the
+ * synonyms share a single block, so one call to free
+ * is sufficient.
  *
  * @param elem the address of the thesaurusEntry being freed.
  *
@@ -75,26 +87,25 @@ static int StringCompare(const void *elem1, const void *elem2)
 static void ThesEntryFree(void *elem)
 {
   thesaurusEntry *entry = elem;
-  free(entry->word);
-  VectorDispose(&entry->synonyms);
+  free(entry->synonyms);
 } 
 
 /**
- * Disposes of the char * addressed by elem.  Simple
- * wrapper to free.
- * 
- * @param elem
+ * Returns the number of milliseconds since some fixed point in the past,
+ * for timing how long loading takes.
  */
 
-static void StringFree(void *elem)
+static double Milliseconds(void)
 {
-  free(*(void **)elem);
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
 }
 
 /**
- * Tokenizes the flat text thesaurus underneath the specified streamtokenizer,
- * and builds up the specified thesaurus out of the information.  Each
- * line of the flat text thesaurus file is of the form:
+ * Pulls the next line of the flat text thesaurus out of the specified
+ * streamtokenizer and builds a thesaurusEntry out of it.  Each line
+ * of the flat text thesaurus file is of the form:
  *
  *     cold,arctic,blustery,freezing,frigid,icy,nippy,polar
  *
@@ -104,62 +115,561 @@ static void StringFree(void *elem)
  * that each line has at least one word, and the code below even deals with
  * the unlikely scenario that there are zero synonyms.
  *
+ * The streamtokenizer hands back whole lines (its only delimiter is '\n'),
+ * and each line is copied into the entry's block in one go, right behind the
+ * synonym array, with its commas overwritten by '\0's.
+ *
+ * @param st the address of the streamtokenizer layering over the flat text thesaurus.
+ * @param entry the address of the thesaurusEntry to be initialized.
+ * @return true if an entry was read, and false if there are no lines left.
+ */
+
+static bool ReadThesaurusEntry(streamtokenizer *st, thesaurusEntry *entry)
+{
+  const char *line;
+  int length;
+  if (!STNextTokenView(st, &line, &length)) return false;
+
+  entry->numSynonyms = 0;
+  for (const char *comma = memchr(line, ',', length); comma != NULL;
+       comma = memchr(comma + 1, ',', line + length - (comma + 1)))
+    entry->numSynonyms++;
+
+  size_t pointerBytes = entry->numSynonyms * sizeof(char *);
+  entry->synonyms = malloc(pointerBytes + length + 1);
+  assert(entry->synonyms != NULL);
+  entry->word = (char *) entry->synonyms + pointerBytes;
+  memcpy(entry->word, line, length);
+  entry->word[length] = '\0';
+  char *word = entry->word;
+  for (int i = 0; i < entry->numSynonyms; i++) {
+    word = strchr(word, ',');
+    *word++ = '\0';
+    entry->synonyms[i] = word;
+  }
+  return true;
+}
+
+/**
+ * Tokenizes the flat text thesaurus underneath the specified streamtokenizer,
+ * and builds up the specified thesaurus out of the information, one line
+ * at a time.
+ *
  * @param thesuarus the address of the thesaurus of thesaurusEntry records to which
  *                  all of the synonym data should be added.
  * @param st the address of the streamtokenizer layering over the flat text thesaurus
  *           file.
+ * @param status the stream that progress reports are printed to.
  */
 
-static void TokenizeAndBuildThesaurus(hashset *thesaurus, streamtokenizer *st)
+static void TokenizeAndBuildThesaurus(hashset *thesaurus, streamtokenizer *st, FILE *status)
 {
-  printf("Loading thesaurus. Be patient! ");
-  fflush(stdout);
+  fprintf(status, "Loading thesaurus. Be patient! ");
+  fflush(status);
 
-  char buffer[2048];
-  while (STNextToken(st, buffer, sizeof(buffer))) {
-    thesaurusEntry entry;
-    entry.word = strdup(buffer);
-    VectorNew(&entry.synonyms, sizeof(char *), StringFree, 4);
-    while (STNextToken(st, buffer, sizeof(buffer)) && (buffer[0] == ',')) {
-      STNextToken(st, buffer, sizeof(buffer));
-      char *synonym = strdup(buffer);
-      VectorAppend(&entry.synonyms, &synonym);
-    }
+  double start = Milliseconds();
+  thesaurusEntry entry;
+  while (ReadThesaurusEntry(st, &entry)) {
     HashSetEnter(thesaurus, &entry);
     if (HashSetCount(thesaurus) % 1000 == 0) {
-      printf(".");
-      fflush(stdout);
+      fprintf(status, ".");
+      fflush(status);
     }
   }
 
-  printf(" [All done!]\n");
-  fflush(stdout);
+  fprintf(status, " [All done!]\n");
+  fprintf(status, "Loaded serially in %.1f ms.\n", Milliseconds() - start);
+  fflush(status);
+}
+
+/**
+ * Reads everything that can be read from the specified file descriptor
+ * into a single block of dynamically allocated memory.  Reads interrupted
+ * by a signal are retried.  The text is tokenized with STNewFromMemory later
+ * on, so anything longer than INT_MAX characters is refused with EFBIG.
+ *
+ * @param fd the file descriptor, which is left open.
+ * @param length the address where the number of bytes read is placed.
+ * @return the block, which the caller is responsible for freeing, or NULL
+ *         (with errno set) if the file couldn't be read in its entirety.
+ */
+
+static char *ReadWholeFile(int fd, size_t *length)
+{
+  size_t capacity = 1 << 20;
+  char *text = malloc(capacity);
+  assert(text != NULL);
+  *length = 0;
+  while (true) {
+    if (*length == capacity) {
+      capacity *= 2;
+      text = realloc(text, capacity);
+      assert(text != NULL);
+    }
+    ssize_t numRead = read(fd, text + *length, capacity - *length);
+    if (numRead == 0) return text;
+    if (numRead < 0 && errno == EINTR) continue;
+    if (numRead > 0 && *length + numRead <= INT_MAX) {
+      *length += numRead;
+      continue;
+    }
+    if (numRead > 0) errno = EFBIG;
+    free(text);
+    return NULL;
+  }
+}
+
+/**
+ * Convenience struct pairing a freshly parsed entry with the hash code of
+ * its word, so the thesaurus needn't hash the word again when it's entered.
+ */
+
+typedef struct {
+  thesaurusEntry entry;
+  int hashCode;
+} hashedEntry;
+
+/**
+ * Convenience struct describing one slice of the thesaurus text, made up of
+ * whole lines, along with the hashedEntrys built from those lines, in the
+ * order the lines appear.
+ */
+
+typedef struct {
+  const char *text;
+  int length;
+  vector entries;
+} thesaurusChunk;
+
+/**
+ * Threadpool task that tokenizes one chunk of the thesaurus text, builds an
+ * entry out of each of its lines, and hashes each entry's word.  Nothing is
+ * shared with the tasks handling the other chunks.
+ *
+ * @param auxData the address of the thesaurusChunk.
+ */
+
+static void ParseThesaurusChunk(void *auxData)
+{
+  thesaurusChunk *chunk = auxData;
+  streamtokenizer st;
+  hashedEntry hashed;
+  STNewFromMemory(&st, chunk->text, chunk->length, "\n", true);
+  VectorNew(&chunk->entries, sizeof(hashedEntry), NULL, 0);
+  while (ReadThesaurusEntry(&st, &hashed.entry)) {
+    hashed.hashCode = StringHash(&hashed.entry, INT_MAX);
+    VectorAppend(&chunk->entries, &hashed);
+  }
+  STDispose(&st);
+}
+
+/**
+ * Splitting text into chunks that are processed in parallel: chunk i of
+ * numChunks ends with the line running through its fair share of the text
+ * (or the text's last character, for the last chunk), so no line is ever
+ * split between two chunks.  Chunks can come out empty when lines are long.
+ *
+ * @param text the address of the first character of the text.
+ * @param length the number of characters in the text.
+ * @param chunkStart the address where chunk i begins (just past where chunk i - 1 ends).
+ * @return the address just past the last character of chunk i.
+ */
+
+static const char *ChunkEnd(const char *text, size_t length, const char *chunkStart, int i, int numChunks)
+{
+  const char *end = text + length;
+  if (i == numChunks - 1) return end;
+  const char *share = text + (long) length * (i + 1) / numChunks;
+  if (share < chunkStart) share = chunkStart;
+  const char *newline = memchr(share, '\n', end - share);
+  return (newline == NULL) ? end : newline + 1;
+}
+
+/**
+ * Builds up the specified thesaurus out of the entire flat text thesaurus,
+ * which has already been read into memory.  The text is split into
+ * kChunksPerThread chunks per thread, each ending at a line boundary, and
+ * the chunks are parsed on the threads of a threadpool.  Tokenizing, copying
+ * and hashing the words all run in parallel.  The entries are then entered
+ * into the thesaurus on this thread, in their original order, which means a
+ * word listed twice ends up with its last synonym list, just as it would if
+ * the file were loaded serially.  That merge is left serial on purpose: the
+ * thesaurus is one plain hashset, so per-thread partial tables would only
+ * have to be probed and copied into it all over again, while entering an
+ * already hashed entry into a presized table costs little more than the copy.
+ *
+ * @param thesaurus the address of the thesaurus to which all of the entries are added.
+ *                  It must have been built by HashSetNewCachingHashCodes around StringHash.
+ * @param text the address of the first character of the thesaurus text.
+ * @param length the number of characters in the thesaurus text.
+ * @param numThreads the number of threads to parse with, or 0 for one per processor.
+ * @param status the stream that the timings are printed to.
+ */
+
+static const int kChunksPerThread = 4;
+static void LoadThesaurusInParallel(hashset *thesaurus, const char *text, size_t length, int numThreads, FILE *status)
+{
+  threadpool pool;
+  double start = Milliseconds();
+  ThreadPoolNew(&pool, numThreads);
+  int numChunks = kChunksPerThread * ThreadPoolNumThreads(&pool);
+  thesaurusChunk chunks[numChunks];
+  const char *chunkStart = text;
+  for (int i = 0; i < numChunks; i++) {
+    const char *chunkEnd = ChunkEnd(text, length, chunkStart, i, numChunks);
+    chunks[i].text = chunkStart;
+    chunks[i].length = chunkEnd - chunkStart;
+    chunkStart = chunkEnd;
+    ThreadPoolSchedule(&pool, ParseThesaurusChunk, &chunks[i]);
+  }
+  ThreadPoolWait(&pool);
+  double parsed = Milliseconds();
+
+  int numEntries = 0;
+  for (int i = 0; i < numChunks; i++)
+    numEntries += VectorLength(&chunks[i].entries);
+  HashSetReserve(thesaurus, HashSetCount(thesaurus) + numEntries);
+  for (int i = 0; i < numChunks; i++) {
+    for (int j = 0; j < VectorLength(&chunks[i].entries); j++) {
+      hashedEntry *hashed = VectorNth(&chunks[i].entries, j);
+      HashSetEnterWithHashCode(thesaurus, &hashed->entry, hashed->hashCode);
+    }
+    VectorDispose(&chunks[i].entries); // the entries themselves now belong to the thesaurus
+  }
+
+  fprintf(status, "Parsed %d chunks on %d threads in %.1f ms, and merged them in %.1f ms.\n",
+	 numChunks, ThreadPoolNumThreads(&pool), parsed - start, Milliseconds() - parsed);
+  ThreadPoolDispose(&pool);
 }
 
 /**
  * Higher-level function that confirms that the flat text file actually
  * exists and can be opened.  If successful, ReadThesaurus layers a
  * streamtokenizer over the file, passes the buck to TokenizeAndBuildThesaurus,
- * and then kills the streamtokenizer and the stream.
+ * and then kills the streamtokenizer.  Regular files are mapped into memory
+ * and tokenized in place; anything that can't be mapped (a pipe, say) is read
+ * straight from its file descriptor instead.  When numThreads isn't negative,
+ * the whole file is read into memory and handed to LoadThesaurusInParallel.
  *
  * @param thesuarus the address of the thesaurus of thesaurusEntry records to which
  *                  all of the synonym data should be added.
  * @param filename the name of the flat text file of thesaurus data.
+ * @param numThreads the number of threads to load with (0 for one per processor),
+ *                   or -1 to load serially.
+ * @param status the stream that progress reports are printed to.
  */
 
-static void ReadThesaurus(hashset *thesaurus, const char *filename)
+static void ReadThesaurus(hashset *thesaurus, const char *filename, int numThreads, FILE *status)
 {
-  FILE *infile = fopen(filename, "r");
-  if (infile == NULL) {
+  streamtokenizer st;
+  if (numThreads < 0 && STNewFromMappedFile(&st, filename, "\n", true)) {
+    TokenizeAndBuildThesaurus(thesaurus, &st, status);
+    STDispose(&st);
+    return;
+  }
+
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
     fprintf(stderr, "Could not open thesaurus file named \"%s\"\n", filename);
     exit(1);
   }
   
-  streamtokenizer st;
-  STNew(&st, infile, ",\n", false);
-  TokenizeAndBuildThesaurus(thesaurus, &st);
-  STDispose(&st);
-  fclose(infile);
+  if (numThreads < 0) {
+    STNewFromDescriptor(&st, fd, "\n", true);
+    TokenizeAndBuildThesaurus(thesaurus, &st, status);
+    int error = STError(&st);
+    STDispose(&st);
+    if (error != 0) {
+      fprintf(stderr, "Could not read thesaurus file named \"%s\": %s\n", filename, strerror(error));
+      exit(1);
+    }
+  } else {
+    size_t length;
+    char *text = ReadWholeFile(fd, &length);
+    if (text == NULL) {
+      fprintf(stderr, "Could not read thesaurus file named \"%s\": %s\n", filename, strerror(errno));
+      exit(1);
+    }
+    LoadThesaurusInParallel(thesaurus, text, length, numThreads, status);
+    free(text);
+  }
+  close(fd);
+}
+
+/**
+ * Prints a one-line summary of how the thesaurus is laid out in memory,
+ * so the effect of the table size and the choice of engine is easy to see.
+ *
+ * @param thesaurus the address of the fully loaded thesaurus.
+ * @param status the stream that the summary is printed to.
+ */
+
+static void AddEntryBytes(void *elem, void *auxData)
+{
+  const thesaurusEntry *entry = elem;
+  const char *last = (entry->numSynonyms == 0) ? entry->word : entry->synonyms[entry->numSynonyms - 1];
+  *(long *) auxData += entry->numSynonyms * sizeof(char *) + (last + strlen(last) + 1 - entry->word);
+}
+
+static void PrintMemoryUsage(hashset *thesaurus, FILE *status)
+{
+  hashsetStats stats;
+  long entryBytes = 0;
+  HashSetStats(thesaurus, &stats);
+  HashSetMap(thesaurus, AddEntryBytes, &entryBytes);
+  fprintf(status, "Loaded %d words into %d slots (longest probe %d, %d rehashes): "
+	 "%.1f MB of table, %.1f MB of words and synonyms.\n",
+	 stats.count, stats.numBuckets, stats.longestChain, stats.numRehashes,
+	 stats.bytesReserved / 1048576.0, entryBytes / 1048576.0);
+}
+
+static const int kApproximateWordCount = (1 << 19) - 1; // six-digit Marsenne prime
+
+/**
+ * The compiled thesaurus image.  Parsing the text and building the hashset
+ * takes far longer than anything else the program does, so thesaurus-lookup -c
+ * does it once and writes the result to a binary image, which later runs map
+ * into memory and answer queries from directly.  Nothing is parsed, copied,
+ * or allocated at startup, and since the image is mapped shared and read-only,
+ * any number of concurrent processes share a single copy of its pages.
+ *
+ * The image is laid out as follows, with every number a native-endian
+ * 32-bit unsigned integer:
+ *
+ *    imageHeader                    the magic string and the section sizes
+ *    slots[numSlots]                a hash index: the number of an entry plus one,
+ *                                   or 0 for an empty slot
+ *    entries[numEntries]            one imageEntry per word
+ *    synonyms[numSynonymRefs]       string offsets, with each entry's synonyms contiguous
+ *    strings[stringBytes]           every distinct word, '\0'-terminated, stored once
+ *
+ * numSlots is a power of two at least twice numEntries, and words are placed
+ * by ImageHash with linear probing.  ImageHash is fixed by the format (unlike
+ * StringHash, whose results depend on the width of a long), so an image can be
+ * moved between machines with the same byte order.
+ */
+
+static const char kImageMagic[8] = "THSIMG1";
+
+typedef struct {
+  char magic[8];
+  uint32_t numEntries;
+  uint32_t numSlots;
+  uint32_t numSynonymRefs;
+  uint32_t stringBytes;
+} imageHeader;
+
+typedef struct {
+  uint32_t word;          // offset of the word within strings
+  uint32_t firstSynonym;  // index of the entry's first synonym within synonyms
+  uint32_t numSynonyms;
+} imageEntry;
+
+typedef struct {
+  void *base;             // the mapping itself
+  size_t size;
+  const imageHeader *header;
+  const uint32_t *slots;
+  const imageEntry *entries;
+  const uint32_t *synonyms;
+  const char *strings;
+} thesaurusImage;
+
+/**
+ * 32-bit FNV-1a, which is the hash function the image's index is built with.
+ */
+
+static uint32_t ImageHash(const char *word)
+{
+  uint32_t hashcode = 2166136261u;
+  for (const unsigned char *c = (const unsigned char *) word; *c != '\0'; c++)
+    hashcode = (hashcode ^ *c) * 16777619u;
+  return hashcode;
+}
+
+/**
+ * Convenience struct used while compiling an image: the string pool under
+ * construction, along with a hashset of stringOffset records that remembers
+ * where each distinct string already landed.
+ */
+
+typedef struct {
+  const char *string;
+  uint32_t offset;
+} stringOffset;
+
+typedef struct {
+  hashset offsets;
+  char *strings;
+  uint32_t numBytes;
+  uint32_t capacity;
+  vector entries;         // of imageEntry
+  vector synonyms;        // of uint32_t
+} imageBuilder;
+
+static uint32_t InternString(imageBuilder *builder, const char *string)
+{
+  bool inserted;
+  stringOffset key = { string, builder->numBytes };
+  stringOffset *found = HashSetFindOrInsert(&builder->offsets, &key, &inserted);
+  if (!inserted) return found->offset;
+
+  uint32_t length = strlen(string) + 1;
+  while (builder->numBytes + length > builder->capacity) {
+    builder->capacity *= 2;
+    builder->strings = realloc(builder->strings, builder->capacity);
+    assert(builder->strings != NULL);
+  }
+  memcpy(builder->strings + builder->numBytes, string, length);
+  builder->numBytes += length;
+  return key.offset;
+}
+
+static void AddEntryToImage(void *elem, void *auxData)
+{
+  thesaurusEntry *entry = elem;
+  imageBuilder *builder = auxData;
+  imageEntry compiled;
+  compiled.word = InternString(builder, entry->word);
+  compiled.firstSynonym = VectorLength(&builder->synonyms);
+  compiled.numSynonyms = entry->numSynonyms;
+  for (int i = 0; i < entry->numSynonyms; i++) {
+    uint32_t offset = InternString(builder, entry->synonyms[i]);
+    VectorAppend(&builder->synonyms, &offset);
+  }
+  VectorAppend(&builder->entries, &compiled);
+}
+
+/**
+ * Compiles the fully loaded thesaurus into an image and writes it to the
+ * named file.
+ *
+ * @param thesaurus the address of the hashset of thesaurusEntry records.
+ * @param filename the name of the image file, which is created or replaced.
+ * @return true if the image was written, and false if the file couldn't be written.
+ */
+
+static bool WriteThesaurusImage(hashset *thesaurus, const char *filename)
+{
+  imageBuilder builder;
+  HashSetNewUsingEngine(&builder.offsets, sizeof(stringOffset), kApproximateWordCount,
+			StringHash, StringCompare, NULL, kHashSetOpenAddressing);
+  builder.capacity = 1 << 20;
+  builder.numBytes = 0;
+  builder.strings = malloc(builder.capacity);
+  assert(builder.strings != NULL);
+  VectorNew(&builder.entries, sizeof(imageEntry), NULL, HashSetCount(thesaurus));
+  VectorNew(&builder.synonyms, sizeof(uint32_t), NULL, 0);
+  HashSetMap(thesaurus, AddEntryToImage, &builder);
+
+  imageHeader header;
+  memcpy(header.magic, kImageMagic, sizeof(header.magic));
+  header.numEntries = VectorLength(&builder.entries);
+  header.numSlots = 1;
+  while (header.numSlots < 2 * header.numEntries) header.numSlots *= 2;
+  header.numSynonymRefs = VectorLength(&builder.synonyms);
+  header.stringBytes = builder.numBytes;
+
+  uint32_t *slots = calloc(header.numSlots, sizeof(uint32_t));
+  assert(slots != NULL);
+  for (uint32_t i = 0; i < header.numEntries; i++) {
+    const imageEntry *entry = VectorNth(&builder.entries, i);
+    uint32_t slot = ImageHash(builder.strings + entry->word) & (header.numSlots - 1);
+    while (slots[slot] != 0) slot = (slot + 1) & (header.numSlots - 1);
+    slots[slot] = i + 1;
+  }
+
+  FILE *outfile = fopen(filename, "wb");
+  bool written = outfile != NULL;
+  if (written) {
+    fwrite(&header, sizeof(header), 1, outfile);
+    fwrite(slots, sizeof(uint32_t), header.numSlots, outfile);
+    if (header.numEntries > 0) fwrite(VectorNth(&builder.entries, 0), sizeof(imageEntry), header.numEntries, outfile);
+    if (header.numSynonymRefs > 0) fwrite(VectorNth(&builder.synonyms, 0), sizeof(uint32_t), header.numSynonymRefs, outfile);
+    fwrite(builder.strings, 1, header.stringBytes, outfile);
+    written = !ferror(outfile);
+    written = (fclose(outfile) == 0) && written;
+  }
+
+  free(slots);
+  free(builder.strings);
+  VectorDispose(&builder.entries);
+  VectorDispose(&builder.synonyms);
+  HashSetDispose(&builder.offsets);
+  return written;
+}
+
+/**
+ * Maps the named image into memory, and locates its sections.
+ *
+ * @param image the address of the thesaurusImage to be initialized.
+ * @param filename the name of the image file.
+ * @return true if the file is an image and has been mapped, and false (with
+ *         nothing mapped) if it isn't an image at all.  The program exits
+ *         if the file claims to be an image, but its sections don't fit it.
+ */
+
+static bool MapThesaurusImage(thesaurusImage *image, const char *filename)
+{
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) return false;
+  struct stat info;
+  bool mapped = fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size >= (off_t) sizeof(imageHeader);
+  if (mapped) {
+    image->size = info.st_size;
+    image->base = mmap(NULL, image->size, PROT_READ, MAP_SHARED, fd, 0);
+    mapped = image->base != MAP_FAILED;
+  }
+  close(fd);
+  if (!mapped) return false;
+
+  const imageHeader *header = image->base;
+  uint64_t expectedSize = sizeof(imageHeader) + (uint64_t) header->numSlots * sizeof(uint32_t) +
+    (uint64_t) header->numEntries * sizeof(imageEntry) + (uint64_t) header->numSynonymRefs * sizeof(uint32_t) +
+    header->stringBytes;
+  if (memcmp(header->magic, kImageMagic, sizeof(header->magic)) != 0) {
+    munmap(image->base, image->size);
+    return false;
+  }
+
+  if (expectedSize != image->size || header->numSlots == 0 || (header->numSlots & (header->numSlots - 1)) != 0 ||
+      header->numSlots < header->numEntries + 1 ||
+      (header->stringBytes > 0 && ((const char *) image->base)[image->size - 1] != '\0')) {
+    fprintf(stderr, "\"%s\" is a damaged thesaurus image.  Compile it again with -c.\n", filename);
+    exit(1);
+  }
+
+  image->header = header;
+  image->slots = (const uint32_t *) (header + 1);
+  image->entries = (const imageEntry *) (image->slots + header->numSlots);
+  image->synonyms = (const uint32_t *) (image->entries + header->numEntries);
+  image->strings = (const char *) (image->synonyms + header->numSynonymRefs);
+  return true;
+}
+
+static void UnmapThesaurusImage(thesaurusImage *image)
+{
+  munmap(image->base, image->size);
+}
+
+/**
+ * Returns the entry for the specified word, or NULL if the image doesn't have one.
+ * MapThesaurusImage only checks that the sections fit the file, so the
+ * contents of an image are trusted as written by WriteThesaurusImage;
+ * the probe count is capped all the same, so a corrupt index can't
+ * send a lookup around the table forever.
+ */
+
+static const imageEntry *LookupInImage(const thesaurusImage *image, const char *word)
+{
+  const imageHeader *header = image->header;
+  uint32_t mask = header->numSlots - 1, slot = ImageHash(word) & mask;
+  for (uint32_t probes = 0; probes < header->numSlots && image->slots[slot] != 0; probes++) {
+    const imageEntry *entry = &image->entries[image->slots[slot] - 1];
+    if (strcmp(image->strings + entry->word, word) == 0) return entry;
+    slot = (slot + 1) & mask;
+  }
+  return NULL;
 }
 
 /**
@@ -185,50 +695,300 @@ static int RandomInteger(int low, int high)
   return low + offset;
 }
 
+/**
+ * Convenience struct bundling the two forms the thesaurus can take: the
+ * hashset of thesaurusEntry records built from the text file, or a mapped
+ * image.  Exactly one of the two is in use.
+ */
+
+typedef struct {
+  hashset *entries;
+  const thesaurusImage *image;
+} thesaurus;
+
+/**
+ * Looks up the specified word, and if it's there and has any synonyms,
+ * chooses one of them at random.  Lookups only ever read the thesaurus,
+ * so any number of threads can call this at once, provided each passes
+ * its own seed.
+ *
+ * @param t the address of the thesaurus.
+ * @param word the word to look up.
+ * @param synonym the address where the chosen synonym is placed, or NULL
+ *                if the word has no synonyms.
+ * @param seed the address of the state that rand_r uses to choose the synonym,
+ *             or NULL to choose with RandomInteger (which isn't thread-safe).
+ * @return true if and only if the word is in the thesaurus.
+ */
+
+static int ChooseSynonym(int numSynonyms, unsigned int *seed)
+{
+  return (seed == NULL) ? RandomInteger(0, numSynonyms - 1) : rand_r(seed) % numSynonyms;
+}
+
+static bool LookupRandomSynonym(const thesaurus *t, const char *word, const char **synonym, unsigned int *seed)
+{
+  *synonym = NULL;
+  if (t->image != NULL) {
+    const imageEntry *entry = LookupInImage(t->image, word);
+    if (entry == NULL) return false;
+    if (entry->numSynonyms > 0)
+      *synonym = t->image->strings +
+	t->image->synonyms[entry->firstSynonym + ChooseSynonym(entry->numSynonyms, seed)];
+    return true;
+  }
+
+  thesaurusEntry *found = HashSetLookup(t->entries, &word);
+  if (found == NULL) return false;
+  if (found->numSynonyms > 0)
+    *synonym = found->synonyms[ChooseSynonym(found->numSynonyms, seed)];
+  return true;
+}
+
 /**
  * Simple question loop that prompts the user for a word, and
  * then looks up the word in the thesaurus.  If present, it
  * selects one of the its synonyms at random, printing it along
  * with the user supplied word.
  *
- * @param thesuarus the address of the hashset housing all of the
- *                  synonyms sets of a large collection of English
- *                  words and phrases.
+ * @param t the address of the thesaurus housing all of the
+ *          synonyms sets of a large collection of English
+ *          words and phrases.
  */
 
-static void QueryThesaurus(hashset *thesaurus)
+static void QueryThesaurus(const thesaurus *t)
 {
   char response[1024];
-  char *responsep = response;
   while (true) {
     printf("Go ahead and enter a word: ");
     fgets(response, sizeof(response), stdin);
     response[strlen(response) - 1] = '\0';
     if (strlen(response) == 0) return;
-    thesaurusEntry *found = HashSetLookup(thesaurus, &responsep);
-    if (found != NULL) {
-      int numSynonyms = VectorLength(&found->synonyms);
-      char *synonym = *(char **) VectorNth(&found->synonyms, RandomInteger(0, numSynonyms - 1));
-      printf("We found \"%s\" in the thesaurus! Its related word of the day is \"%s\".\n", response, synonym);
-    } else {
+    const char *synonym;
+    if (!LookupRandomSynonym(t, response, &synonym, NULL)) {
       printf("My apologies, but I know of no such word spelled \"%s\".\n", response);
+    } else if (synonym == NULL) {
+      printf("We found \"%s\" in the thesaurus, but it has no related words.\n", response);
+    } else {
+      printf("We found \"%s\" in the thesaurus! Its related word of the day is \"%s\".\n", response, synonym);
     }
   }
 }
 
 /**
- * Provides the enty point to the program.
+ * Convenience struct describing one slice of a batch of queries, made up of
+ * whole lines, along with everything the slice needs to be answered
+ * independently of the others: its own seed for choosing synonyms, and its
+ * own block of output.
  */
 
-static const int kApproximateWordCount = (1 << 19) - 1; // six-digit Marsenne prime
+typedef struct {
+  const thesaurus *t;
+  const char *text;
+  int length;
+  unsigned int seed;
+  char *output;
+  size_t outputLength;
+  int numQueries;
+} queryChunk;
+
+/**
+ * Threadpool task that answers every query in one chunk of a batch, writing
+ * one line per query to the chunk's output: the word, "found" or "missing",
+ * and a synonym chosen at random (or nothing, if there isn't one), all
+ * separated by tabs.  A trailing '\r' is ignored, and lines that are blank
+ * once it's gone are skipped.  Lookups need a null-terminated word, so each
+ * query is copied out of the text into a buffer that grows to fit the
+ * longest one, and is never truncated.
+ *
+ * @param auxData the address of the queryChunk.
+ */
+
+static void AnswerQueryChunk(void *auxData)
+{
+  queryChunk *chunk = auxData;
+  streamtokenizer st;
+  const char *line;
+  int length;
+  size_t capacity = 64;
+  char *word = malloc(capacity);
+  assert(word != NULL);
+  FILE *out = open_memstream(&chunk->output, &chunk->outputLength);
+  assert(out != NULL);
+  STNewFromMemory(&st, chunk->text, chunk->length, "\n", true);
+  chunk->numQueries = 0;
+  while (STNextTokenView(&st, &line, &length)) {
+    if (length > 0 && line[length - 1] == '\r') length--;
+    if (length == 0) continue;
+    if ((size_t) length >= capacity) {
+      capacity = (size_t) length + 1;
+      word = realloc(word, capacity);
+      assert(word != NULL);
+    }
+    memcpy(word, line, length);
+    word[length] = '\0';
+    const char *synonym;
+    bool found = LookupRandomSynonym(chunk->t, word, &synonym, &chunk->seed);
+    fprintf(out, "%s\t%s\t%s\n", word, found ? "found" : "missing", (synonym == NULL) ? "" : synonym);
+    chunk->numQueries++;
+  }
+  STDispose(&st);
+  fclose(out);
+  free(word);
+}
+
+/**
+ * Non-interactive counterpart to QueryThesaurus.  Every query (one word per
+ * line) is read in from the named file, or from standard input if the name
+ * is "-", and the batch is split at line boundaries into kChunksPerThread
+ * chunks per thread.  The chunks are answered in parallel, and their output
+ * is written to standard output in the order the queries came in.  The time
+ * taken and the throughput go to standard error, so they never mix with the
+ * answers.
+ *
+ * @param t the address of the thesaurus.
+ * @param filename the name of the file of queries, or "-" for standard input.
+ * @param numThreads the number of threads to answer with, or 0 for one per processor.
+ */
+
+static void AnswerQueriesInBatch(const thesaurus *t, const char *filename, int numThreads)
+{
+  int fd = (strcmp(filename, "-") == 0) ? STDIN_FILENO : open(filename, O_RDONLY);
+  if (fd == -1) {
+    fprintf(stderr, "Could not open the queries file named \"%s\"\n", filename);
+    exit(1);
+  }
+
+  size_t length;
+  char *text = ReadWholeFile(fd, &length);
+  if (text == NULL) {
+    fprintf(stderr, "Could not read the queries file named \"%s\": %s\n", filename, strerror(errno));
+    exit(1);
+  }
+  if (fd != STDIN_FILENO) close(fd);
+
+  threadpool pool;
+  double start = Milliseconds();
+  ThreadPoolNew(&pool, numThreads);
+  int numChunks = kChunksPerThread * ThreadPoolNumThreads(&pool);
+  queryChunk chunks[numChunks];
+  const char *chunkStart = text;
+  unsigned int seed = time(NULL);
+  for (int i = 0; i < numChunks; i++) {
+    const char *chunkEnd = ChunkEnd(text, length, chunkStart, i, numChunks);
+    chunks[i].t = t;
+    chunks[i].text = chunkStart;
+    chunks[i].length = chunkEnd - chunkStart;
+    chunks[i].seed = seed + i;
+    chunkStart = chunkEnd;
+    ThreadPoolSchedule(&pool, AnswerQueryChunk, &chunks[i]);
+  }
+  ThreadPoolWait(&pool);
+  double answered = Milliseconds();
+
+  long numQueries = 0;
+  for (int i = 0; i < numChunks; i++) {
+    fwrite(chunks[i].output, 1, chunks[i].outputLength, stdout);
+    free(chunks[i].output);
+    numQueries += chunks[i].numQueries;
+  }
+  fflush(stdout);
+
+  double seconds = (answered - start) / 1000;
+  fprintf(stderr, "Answered %ld queries on %d threads in %.1f ms (%.0f queries/sec), and wrote them in %.1f ms.\n",
+	  numQueries, ThreadPoolNumThreads(&pool), answered - start,
+	  (seconds > 0) ? numQueries / seconds : 0.0, Milliseconds() - answered);
+  ThreadPoolDispose(&pool);
+  free(text);
+}
+
+/**
+ * Provides the enty point to the program.  Usage:
+ *
+ *     thesaurus-lookup [-j threads] [-c image-file] [-b queries-file] [thesaurus-file]
+ *
+ * With -j, the thesaurus is parsed on the specified number of threads
+ * (-j 0 uses one per processor).  Without it, it's loaded serially.
+ * With -c, the loaded thesaurus is compiled into the named image file
+ * instead of being queried, and every status message goes to standard
+ * error, as it does with -b.  With -b, the queries are answered in a
+ * batch (see AnswerQueriesInBatch) on the -j threads, or on one thread
+ * per processor, rather than interactively.  If thesaurus-file is an image,
+ * it's mapped and queried directly, and nothing is parsed at all.
+ * -c and -b can't be combined, and the thread count must be a whole
+ * number between 0 and kMaxThreads; anything else prints the usage
+ * line and exits.
+ */
+
+static void ExitWithUsage(void)
+{
+  fprintf(stderr, "Usage: thesaurus-lookup [-j threads] [-c image-file] [-b queries-file] [thesaurus-file]\n");
+  exit(1);
+}
+
+static const long kMaxThreads = 256;
 int main(int argc, const char *argv[])
 {
-  hashset thesaurus;
-  HashSetNew(&thesaurus, sizeof(thesaurusEntry), kApproximateWordCount, StringHash, StringCompare, ThesEntryFree);
+  int numThreads = -1;
+  const char *imageFileName = NULL, *queriesFileName = NULL;
+  while (argc >= 3 && (strcmp(argv[1], "-j") == 0 || strcmp(argv[1], "-c") == 0 || strcmp(argv[1], "-b") == 0)) {
+    if (argv[1][1] == 'j') {
+      char *end;
+      errno = 0;
+      long requested = strtol(argv[2], &end, 10);
+      if (errno != 0 || end == argv[2] || *end != '\0' || requested < 0 || requested > kMaxThreads) {
+	fprintf(stderr, "The thread count must be a number from 0 through %ld, not \"%s\".\n", kMaxThreads, argv[2]);
+	ExitWithUsage();
+      }
+      numThreads = requested;
+    } else if (argv[1][1] == 'c') {
+      imageFileName = argv[2];
+    } else {
+      queriesFileName = argv[2];
+    }
+    argc -= 2;
+    argv += 2;
+  }
+
+  if (imageFileName != NULL && queriesFileName != NULL) {
+    fprintf(stderr, "-c compiles the thesaurus instead of querying it, so it can't be combined with -b.\n");
+    ExitWithUsage();
+  }
+
   const char *thesaurusFileName = (argc == 1) ? 
     "../assn-3-vector-hashset-data/thesaurus.txt" : argv[1];
-  ReadThesaurus(&thesaurus, thesaurusFileName);
-  QueryThesaurus(&thesaurus);
-  HashSetDispose(&thesaurus);
+  // only an interactive session reports its progress on stdout: with -b, stdout is for answers alone,
+  // and with -c, it's left for whatever script is driving the compile
+  FILE *status = (queriesFileName == NULL && imageFileName == NULL) ? stdout : stderr;
+  thesaurusImage image;
+  double start = Milliseconds();
+  if (imageFileName == NULL && MapThesaurusImage(&image, thesaurusFileName)) {
+    fprintf(status, "Mapped a compiled thesaurus of %u words (%.1f MB) in %.2f ms.\n",
+	    image.header->numEntries, image.size / 1048576.0, Milliseconds() - start);
+    thesaurus t = { NULL, &image };
+    if (queriesFileName != NULL) AnswerQueriesInBatch(&t, queriesFileName, (numThreads < 0) ? 0 : numThreads);
+    else QueryThesaurus(&t);
+    UnmapThesaurusImage(&image);
+    return 0;
+  }
+
+  hashset entries;
+  HashSetNewCachingHashCodes(&entries, sizeof(thesaurusEntry), kApproximateWordCount,
+			     StringHash, StringCompare, ThesEntryFree, kHashSetOpenAddressing);
+  ReadThesaurus(&entries, thesaurusFileName, (numThreads < 0) ? -1 : numThreads, status);
+  HashSetCompact(&entries); // kApproximateWordCount is generous, and the table is read-only from here on
+  PrintMemoryUsage(&entries, status);
+  if (imageFileName != NULL) {
+    bool written = WriteThesaurusImage(&entries, imageFileName);
+    if (written) fprintf(status, "Compiled the thesaurus into \"%s\".\n", imageFileName);
+    else fprintf(stderr, "Could not write the thesaurus image to \"%s\".\n", imageFileName);
+    HashSetDispose(&entries);
+    return written ? 0 : 1;
+  }
+
+  thesaurus t = { &entries, NULL };
+  if (queriesFileName != NULL) AnswerQueriesInBatch(&t, queriesFileName, (numThreads < 0) ? 0 : numThreads);
+  else QueryThesaurus(&t);
+  HashSetDispose(&entries);
   return 0;
 }
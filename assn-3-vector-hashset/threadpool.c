@@ -0,0 +1,145 @@
+#include "threadpool.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+
+typedef struct threadpoolTask {
+  ThreadPoolTask task;
+  void *auxData;
+  threadpoolGroup *group; // NULL unless scheduled by ThreadPoolScheduleInGroup
+  struct threadpoolTask *next;
+} threadpoolTask;
+
+/**
+ * Loop run by every worker thread: wait for a task, run it with the lock
+ * released, and repeat until the pool is disposed of and nothing is left
+ * to do.
+ */
+
+static void *Worker(void *data)
+{
+  threadpool *pool = data;
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    while (pool->pending == NULL && !pool->disposing)
+      pthread_cond_wait(&pool->taskAvailable, &pool->lock);
+    if (pool->pending == NULL) break; // disposing, and nothing left to run
+
+    threadpoolTask *next = pool->pending;
+    pool->pending = next->next;
+    if (pool->pending == NULL) pool->last = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    next->task(next->auxData);
+    threadpoolGroup *group = next->group;
+    free(next);
+
+    pthread_mutex_lock(&pool->lock);
+    if (group != NULL && --group->numOutstanding == 0)
+      pthread_cond_broadcast(&group->allTasksDone);
+    if (--pool->numOutstanding == 0)
+      pthread_cond_broadcast(&pool->allTasksDone);
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+void ThreadPoolNew(threadpool *pool, int numThreads)
+{
+  assert(numThreads >= 0);
+  if (numThreads == 0) {
+    long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+    numThreads = (numProcessors > 0) ? numProcessors : 1;
+  }
+
+  pool->numThreads = numThreads;
+  pool->pending = pool->last = NULL;
+  pool->numOutstanding = 0;
+  pool->disposing = false;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->taskAvailable, NULL);
+  pthread_cond_init(&pool->allTasksDone, NULL);
+  pool->threads = malloc(numThreads * sizeof(pthread_t));
+  assert(pool->threads != NULL);
+  for (int i = 0; i < numThreads; i++) {
+    int error = pthread_create(&pool->threads[i], NULL, Worker, pool);
+    assert(error == 0);
+  }
+}
+
+void ThreadPoolDispose(threadpool *pool)
+{
+  ThreadPoolWait(pool);
+  pthread_mutex_lock(&pool->lock);
+  pool->disposing = true;
+  pthread_cond_broadcast(&pool->taskAvailable);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 0; i < pool->numThreads; i++)
+    pthread_join(pool->threads[i], NULL);
+  free(pool->threads);
+  pthread_cond_destroy(&pool->allTasksDone);
+  pthread_cond_destroy(&pool->taskAvailable);
+  pthread_mutex_destroy(&pool->lock);
+}
+
+int ThreadPoolNumThreads(const threadpool *pool)
+{
+  return pool->numThreads;
+}
+
+void ThreadPoolSchedule(threadpool *pool, ThreadPoolTask task, void *auxData)
+{
+  ThreadPoolScheduleInGroup(pool, NULL, task, auxData);
+}
+
+void ThreadPoolScheduleInGroup(threadpool *pool, threadpoolGroup *group, ThreadPoolTask task, void *auxData)
+{
+  assert(task != NULL);
+  threadpoolTask *scheduled = malloc(sizeof(threadpoolTask));
+  assert(scheduled != NULL);
+  scheduled->task = task;
+  scheduled->auxData = auxData;
+  scheduled->group = group;
+  scheduled->next = NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  if (group != NULL) group->numOutstanding++;
+  if (pool->last == NULL)
+    pool->pending = scheduled;
+  else
+    pool->last->next = scheduled;
+  pool->last = scheduled;
+  pool->numOutstanding++;
+  pthread_cond_signal(&pool->taskAvailable);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void ThreadPoolWait(threadpool *pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  while (pool->numOutstanding > 0)
+    pthread_cond_wait(&pool->allTasksDone, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void ThreadPoolGroupNew(threadpoolGroup *group)
+{
+  group->numOutstanding = 0;
+  pthread_cond_init(&group->allTasksDone, NULL);
+}
+
+void ThreadPoolGroupDispose(threadpoolGroup *group)
+{
+  assert(group->numOutstanding == 0);
+  pthread_cond_destroy(&group->allTasksDone);
+}
+
+void ThreadPoolGroupWait(threadpool *pool, threadpoolGroup *group)
+{
+  pthread_mutex_lock(&pool->lock);
+  while (group->numOutstanding > 0)
+    pthread_cond_wait(&group->allTasksDone, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,145 @@
+#ifndef _threadpool_
+#define _threadpool_
+#include "bool.h"
+#include <pthread.h>
+
+/* File: threadpool.h
+ * ------------------
+ * Defines the interface for the threadpool, a fixed set of worker
+ * threads that run whatever tasks they're handed.
+ *
+ * Creating a thread costs far more than handing an existing one a
+ * function to call, so code that wants to split a job across cores
+ * schedules tasks on a pool that's created once and reused.
+ */
+
+/**
+ * Type: ThreadPoolTask
+ * --------------------
+ * Class of function run by a worker thread.  It's handed the auxData
+ * pointer supplied to ThreadPoolSchedule.
+ */
+
+typedef void (*ThreadPoolTask)(void *auxData);
+
+/**
+ * Type: threadpool
+ * ----------------
+ * The concrete representation of the threadpool.  The fields are
+ * exposed, but clients should only interact with a threadpool via
+ * the functions below.
+ */
+
+typedef struct {
+  int numThreads;
+  pthread_t *threads;
+  pthread_mutex_t lock;
+  pthread_cond_t taskAvailable;  // signaled whenever a task is scheduled or the pool is disposed of
+  pthread_cond_t allTasksDone;   // broadcast whenever the number of outstanding tasks drops to 0
+  struct threadpoolTask *pending; // tasks waiting to be run, oldest first
+  struct threadpoolTask *last;
+  int numOutstanding;            // scheduled but not yet finished
+  bool disposing;
+} threadpool;
+
+/**
+ * Type: threadpoolGroup
+ * ---------------------
+ * A set of tasks that can be waited on apart from everything else running
+ * on the same pool, so that two clients sharing a pool never end up waiting
+ * on each other's work.  The fields are guarded by the lock of the pool the
+ * tasks are scheduled on, and clients should only interact with a group via
+ * the functions below.
+ */
+
+typedef struct {
+  int numOutstanding;            // scheduled in the group but not yet finished
+  pthread_cond_t allTasksDone;   // broadcast whenever numOutstanding drops to 0
+} threadpoolGroup;
+
+/**
+ * Function: ThreadPoolNew
+ * -----------------------
+ * Initializes the identified threadpool and starts its numThreads worker
+ * threads, which wait for tasks to be scheduled.  Passing 0 for numThreads
+ * gets one worker per online processor.
+ *
+ * An assert is raised if numThreads is negative, or if the threads
+ * can't be created.
+ */
+
+void ThreadPoolNew(threadpool *pool, int numThreads);
+
+/**
+ * Function: ThreadPoolDispose
+ * ---------------------------
+ * Waits for every scheduled task to finish, then stops and joins all of
+ * the worker threads and releases the pool's resources.  No other thread
+ * may schedule tasks once disposal has begun.
+ */
+
+void ThreadPoolDispose(threadpool *pool);
+
+/**
+ * Function: ThreadPoolNumThreads
+ * ------------------------------
+ * Returns the number of worker threads in the pool.
+ */
+
+int ThreadPoolNumThreads(const threadpool *pool);
+
+/**
+ * Function: ThreadPoolSchedule
+ * ----------------------------
+ * Arranges for task(auxData) to be run by one of the worker threads.  Tasks
+ * are started in the order they're scheduled, but since several run at once,
+ * they can finish in any order.  The call returns right away, without waiting
+ * for the task to start.  Tasks may schedule other tasks, but must never call
+ * ThreadPoolWait.
+ *
+ * An assert is raised if task is NULL.
+ */
+
+void ThreadPoolSchedule(threadpool *pool, ThreadPoolTask task, void *auxData);
+
+/**
+ * Function: ThreadPoolWait
+ * ------------------------
+ * Blocks until every task scheduled so far (including any tasks those
+ * tasks scheduled) has finished running.
+ */
+
+void ThreadPoolWait(threadpool *pool);
+
+/**
+ * Functions: ThreadPoolGroupNew, ThreadPoolGroupDispose
+ * -----------------------------------------------------
+ * Initialize and dispose of a threadpoolGroup.  A group may only be disposed
+ * of once every task scheduled in it has finished.
+ */
+
+void ThreadPoolGroupNew(threadpoolGroup *group);
+void ThreadPoolGroupDispose(threadpoolGroup *group);
+
+/**
+ * Function: ThreadPoolScheduleInGroup
+ * -----------------------------------
+ * Operates exactly the same as ThreadPoolSchedule, except that the task
+ * also counts as part of the specified group.  It's still waited on by
+ * ThreadPoolWait.
+ */
+
+void ThreadPoolScheduleInGroup(threadpool *pool, threadpoolGroup *group, ThreadPoolTask task, void *auxData);
+
+/**
+ * Function: ThreadPoolGroupWait
+ * -----------------------------
+ * Blocks until every task scheduled in the specified group has finished
+ * running.  Tasks scheduled outside the group (by other clients of the pool,
+ * say) aren't waited on.  The group must belong to the specified pool, and
+ * as with ThreadPoolWait, tasks must never call this.
+ */
+
+void ThreadPoolGroupWait(threadpool *pool, threadpoolGroup *group);
+
+#endif
@@ -26,17 +26,103 @@ int VectorIsNull(const vector*v)
     return 1;
   return 0;
   }*/
+
+/**
+ * Copies one element.  Nearly every vector stores 1-, 2-, 4-, 8-, or 16-byte
+ * elements, and a memcpy whose size is known at compile time turns into a
+ * plain load and store, so those sizes get their own cases.  The switch is
+ * on a value that never changes over the vector's lifetime, so the branch
+ * predicts perfectly; anything else falls back on the general memcpy.
+ */
+
+static inline void CopyElem(void *dest, const void *src, int elemSize)
+{
+  switch (elemSize) {
+    case 1: memcpy(dest, src, 1); break;
+    case 2: memcpy(dest, src, 2); break;
+    case 4: memcpy(dest, src, 4); break;
+    case 8: memcpy(dest, src, 8); break;
+    case 16: memcpy(dest, src, 16); break;
+    default: memcpy(dest, src, elemSize); break;
+  }
+}
+
+/**
+ * Returns the address of element 0.  Until a vector outgrows its inline
+ * buffer, dataP stays NULL and the elements live right inside the vector
+ * struct.  (A pointer to the inline buffer would be simpler, but vectors get
+ * copied around by value, most notably inside hashset elements, and the copy
+ * would be left pointing into the original.)
+ */
+
+static inline char *Elements(const vector *v)
+{
+  return (v->dataP != NULL) ? v->dataP : (char *) v->inlineElems.bytes;
+}
+
+/**
+ * Memory accounting for every vector in the program.  Vectors are used from
+ * several threads at once, so the counters are only ever updated atomically.
+ * That only happens when heap memory changes hands, never on the fast paths.
+ * Blocks that come from a client's allocator aren't heap memory, so they're
+ * left out.
+ */
+
+static vectorGlobalStats globalStats;
+
+static void RecordHeapEvent(const allocator *alloc, long *counter)
+{
+  if (alloc == NULL) __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+}
+
+static void RecordHeapChange(const allocator *alloc, long numBytes)
+{
+  if (alloc != NULL) return;
+  long live = __atomic_add_fetch(&globalStats.bytesReserved, numBytes, __ATOMIC_RELAXED);
+  long peak = __atomic_load_n(&globalStats.peakBytesReserved, __ATOMIC_RELAXED);
+  while (live > peak &&
+	 !__atomic_compare_exchange_n(&globalStats.peakBytesReserved, &peak, live, true,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+static long HeapBytes(const vector *v)
+{
+  return (v->dataP == NULL) ? 0 : (long) v->allocSpace * v->elemSize;
+}
+
+static inline int InlineCapacity(int elemSize)
+{
+  return sizeof(((vector *) NULL)->inlineElems.bytes) / elemSize;
+}
+
 void VectorNew(vector *v, int elemSize, VectorFreeFunction freeFn, int initialAllocation)
+{
+  VectorNewUsingAllocator(v, elemSize, freeFn, initialAllocation, NULL);
+}
+
+void VectorNewUsingAllocator(vector *v, int elemSize, VectorFreeFunction freeFn, int initialAllocation,
+			     const allocator *alloc)
 {
   
   assert(elemSize > 0);
+  assert(initialAllocation >= 0);
    
-  v->dataP = malloc(elemSize* initialAllocation);
-  assert(v->dataP!=NULL);
+  if (initialAllocation <= InlineCapacity(elemSize)) {
+    v->dataP = NULL;
+    initialAllocation = InlineCapacity(elemSize);
+  } else {
+    v->dataP = AllocatorAllocate(alloc, (size_t) elemSize * initialAllocation);
+    assert(v->dataP!=NULL);
+    RecordHeapEvent(alloc, &globalStats.numAllocations);
+    RecordHeapChange(alloc, (long) elemSize * initialAllocation);
+  }
   v->elemSize = elemSize;
   v->freeFn = freeFn;
+  v->alloc = alloc;
   v->allocSpace = initialAllocation;
   v->realSize = 0;
+  v->numReallocs = 0;
 }
 
 void VectorDispose(vector *v)
@@ -44,11 +130,15 @@ void VectorDispose(vector *v)
   assert (v!=NULL);
   if(v->realSize>0 && v->freeFn!=NULL){
     for(int i=0; i< v->realSize;i++){
-      void* currentElem = (char*)v->dataP+i*v->elemSize;
+      void* currentElem = Elements(v)+i*v->elemSize;
       v->freeFn(currentElem);
     }
   }
-  free(v->dataP);
+  if (v->dataP != NULL) {
+    RecordHeapEvent(v->alloc, &globalStats.numFrees);
+    RecordHeapChange(v->alloc, -HeapBytes(v));
+    AllocatorRelease(v->alloc, v->dataP, HeapBytes(v));
+  }
 }
 
 int VectorLength(const vector *v)
@@ -62,7 +152,7 @@ void *VectorNth(const vector *v, int position)
   assert (v!=NULL);
   assert(position <v->realSize);
   assert(position>=0);
-  return (char*)v->dataP+position*v->elemSize; 
+  return Elements(v)+position*v->elemSize; 
 }
 
 void VectorReplace(vector *v, const void *elemAddr, int position)
@@ -70,10 +160,61 @@ void VectorReplace(vector *v, const void *elemAddr, int position)
   assert (v!=NULL);
   assert(position < v->realSize);
   assert(position >= 0);
-  void* positionP = ((char*)v->dataP+position*v->elemSize);  
+  void* positionP = (Elements(v)+position*v->elemSize);  
   if(v->freeFn!=NULL)
     v->freeFn(positionP);
-  memcpy(positionP, elemAddr, v->elemSize); 
+  CopyElem(positionP, elemAddr, v->elemSize); 
+}
+
+/**
+ * Moves the elements to a heap block with room for newAllocation
+ * elements, which is presumably more than there's room for now.
+ * The first time around, that means copying them out of the
+ * inline buffer.
+ */
+
+static void Reallocate(vector *v, int newAllocation)
+{
+  long oldBytes = HeapBytes(v), newBytes = (long) newAllocation * v->elemSize;
+  RecordHeapChange(v->alloc, newBytes - oldBytes);
+  v->numReallocs++;
+  if (v->dataP == NULL) {
+    RecordHeapEvent(v->alloc, &globalStats.numAllocations);
+    v->dataP = AllocatorAllocate(v->alloc, newBytes);
+    assert(v->dataP!=NULL);
+    memcpy(v->dataP, v->inlineElems.bytes, v->realSize*v->elemSize);
+  } else {
+    v->dataP = AllocatorReallocate(v->alloc, v->dataP, oldBytes, newBytes);
+    assert(v->dataP!=NULL);
+    RecordHeapEvent(v->alloc, &globalStats.numReallocs);
+  }
+  v->allocSpace = newAllocation;
+}
+
+/**
+ * Makes sure there's room for at least minAllocation elements,
+ * doubling the allocation as many times as it takes.
+ */
+
+static void GrowToFit(vector *v, int minAllocation)
+{
+  if (minAllocation <= v->allocSpace)
+    return;
+
+  int newAllocation = (v->allocSpace == 0) ? 1 : v->allocSpace;
+  while (newAllocation < minAllocation)
+    newAllocation *= 2;
+  Reallocate(v, newAllocation);
+}
+
+void VectorReserve(vector *v, int numElements)
+{
+  assert (v!=NULL);
+  assert(numElements >= 0);
+  if (numElements <= v->allocSpace)
+    return;
+
+  Reallocate(v, numElements);
 }
 
 void VectorInsert(vector *v, const void *elemAddr, int position)
@@ -81,26 +222,18 @@ void VectorInsert(vector *v, const void *elemAddr, int position)
   assert (v!=NULL);
   assert(position >= 0);
   assert(position <= v->realSize);
-  if (v->allocSpace == v->realSize){
-    if(v->allocSpace == 0)
-      v->allocSpace = 1;
-    else
-      v->allocSpace*= 2;
-  
-    v->dataP = realloc(v->dataP, v->allocSpace*v->elemSize);
-    assert(v->dataP!=NULL);
-  }
+  GrowToFit(v, v->realSize + 1);
 
-  char* insertPosition = (char*)v->dataP + position * v->elemSize;
+  char* insertPosition = Elements(v) + position * v->elemSize;
  
   if(position!=v->realSize){
     char* destination = insertPosition + v->elemSize;
-    char* end = (char*)v->dataP + v->realSize*v->elemSize;
+    char* end = Elements(v) + v->realSize*v->elemSize;
     int numOfBytes = end - insertPosition;
     memmove(destination, insertPosition, numOfBytes);
   }
     
-  memcpy(insertPosition, elemAddr, v->elemSize); 
+  CopyElem(insertPosition, elemAddr, v->elemSize); 
  
   v->realSize++;
 
@@ -109,7 +242,57 @@ void VectorInsert(vector *v, const void *elemAddr, int position)
 void VectorAppend(vector *v, const void *elemAddr)
 {
   assert (v!=NULL);
-  VectorInsert(v,elemAddr,v->realSize);
+  if (v->realSize == v->allocSpace)
+    GrowToFit(v, v->realSize + 1);
+  CopyElem(Elements(v) + v->realSize*v->elemSize, elemAddr, v->elemSize);
+  v->realSize++;
+}
+
+void VectorAppendMany(vector *v, const void *elemsAddr, int numElements)
+{
+  assert (v!=NULL);
+  assert(numElements >= 0);
+  if (numElements == 0)
+    return;
+
+  assert(elemsAddr!=NULL);
+  GrowToFit(v, v->realSize + numElements);
+  memcpy(Elements(v) + v->realSize*v->elemSize, elemsAddr, numElements*v->elemSize);
+  v->realSize += numElements;
+}
+
+void VectorResize(vector *v, int newLength)
+{
+  assert (v!=NULL);
+  assert(newLength >= 0);
+  if (newLength < v->realSize) {
+    if (v->freeFn!=NULL)
+      for (int i = newLength; i < v->realSize; i++)
+	v->freeFn(Elements(v) + i*v->elemSize);
+  } else {
+    GrowToFit(v, newLength);
+    memset(Elements(v) + v->realSize*v->elemSize, 0, (newLength - v->realSize)*v->elemSize);
+  }
+
+  v->realSize = newLength;
+}
+
+void VectorShrinkToFit(vector *v)
+{
+  assert (v!=NULL);
+  if (v->dataP == NULL || v->allocSpace == v->realSize) return;
+  if (v->realSize > InlineCapacity(v->elemSize)) {
+    Reallocate(v, v->realSize);
+    return;
+  }
+
+  void *heapElems = v->dataP;
+  memcpy(v->inlineElems.bytes, heapElems, v->realSize*v->elemSize);
+  RecordHeapEvent(v->alloc, &globalStats.numFrees);
+  RecordHeapChange(v->alloc, -HeapBytes(v));
+  AllocatorRelease(v->alloc, heapElems, HeapBytes(v));
+  v->dataP = NULL;
+  v->allocSpace = InlineCapacity(v->elemSize);
 }
 
 void VectorDelete(vector *v, int position)
@@ -118,7 +301,7 @@ void VectorDelete(vector *v, int position)
   assert(position>=0);
   assert(position<v->realSize);
 
-  void* positionP = (char*)v->dataP+position*v->elemSize;
+  void* positionP = Elements(v)+position*v->elemSize;
  
   if(v->freeFn!=NULL)
     v->freeFn(positionP);
@@ -134,7 +317,80 @@ void VectorSort(vector *v, VectorCompareFunction compare)
 {
   assert(compare!= NULL);
   assert (v!=NULL);
-  qsort(v->dataP, v->realSize, v->elemSize, compare);
+  qsort(Elements(v), v->realSize, v->elemSize, compare);
+}
+
+/**
+ * Maps the signed integer at elemAddr to an unsigned 64-bit key that sorts
+ * the same way: sign-extend it, then flip the sign bit so that negative
+ * numbers come before nonnegative ones.
+ */
+
+static unsigned long long IntegerKey(const void *elemAddr, int elemSize)
+{
+  long long value;
+  switch (elemSize) {
+    case 1: value = *(const signed char *) elemAddr; break;
+    case 2: value = *(const short *) elemAddr; break;
+    case 4: value = *(const int *) elemAddr; break;
+    default: value = *(const long long *) elemAddr; break;
+  }
+  return (unsigned long long) value ^ (1ULL << 63);
+}
+
+static const int kRadixBits = 8;
+static const int kRadix = 1 << 8;
+static const int kNumDigits = 64 / 8;
+void VectorSortIntegers(vector *v)
+{
+  assert (v!=NULL);
+  int elemSize = v->elemSize;
+  assert(elemSize == 1 || elemSize == 2 || elemSize == 4 || elemSize == 8);
+  int n = v->realSize;
+  if (n < 2) return;
+
+  // one pass up front to count every digit of every key
+  int counts[kNumDigits][kRadix];
+  memset(counts, 0, sizeof(counts));
+  for (int i = 0; i < n; i++) {
+    unsigned long long key = IntegerKey(Elements(v) + i*elemSize, elemSize);
+    for (int digit = 0; digit < kNumDigits; digit++)
+      counts[digit][(key >> (digit * kRadixBits)) & (kRadix - 1)]++;
+  }
+
+  // the scratch buffer comes from wherever the elements do, and is counted the same way
+  size_t scratchBytes = (size_t) n * elemSize;
+  char *from = Elements(v);
+  char *to = AllocatorAllocate(v->alloc, scratchBytes);
+  assert(to!=NULL);
+  RecordHeapEvent(v->alloc, &globalStats.numAllocations);
+  RecordHeapChange(v->alloc, (long) scratchBytes);
+  for (int digit = 0; digit < kNumDigits; digit++) {
+    int *count = counts[digit];
+    if (count[(IntegerKey(from, elemSize) >> (digit * kRadixBits)) & (kRadix - 1)] == n)
+      continue; // every key has the same digit here, so this pass would change nothing
+
+    int offsets[kRadix];
+    for (int d = 0, sum = 0; d < kRadix; sum += count[d], d++)
+      offsets[d] = sum;
+    for (int i = 0; i < n; i++) {
+      const char *elem = from + i*elemSize;
+      int d = (IntegerKey(elem, elemSize) >> (digit * kRadixBits)) & (kRadix - 1);
+      CopyElem(to + offsets[d]++ * elemSize, elem, elemSize);
+    }
+
+    char *swap = from;
+    from = to;
+    to = swap;
+  }
+
+  if (from != Elements(v)) {
+    memcpy(Elements(v), from, scratchBytes);
+    to = from;
+  }
+  RecordHeapEvent(v->alloc, &globalStats.numFrees);
+  RecordHeapChange(v->alloc, -(long) scratchBytes);
+  AllocatorRelease(v->alloc, to, scratchBytes);
 }
 
 void VectorMap(vector *v, VectorMapFunction mapFn, void *auxData)
@@ -142,7 +398,28 @@ void VectorMap(vector *v, VectorMapFunction mapFn, void *auxData)
   assert(mapFn!=NULL);
   assert (v!=NULL);
     for(int i=0;i<v->realSize;i++)
-      mapFn((char*)v->dataP+i*v->elemSize, auxData);
+      mapFn(Elements(v)+i*v->elemSize, auxData);
+}
+
+void VectorStats(const vector *v, vectorStats *stats)
+{
+  assert (v!=NULL);
+  assert(stats!=NULL);
+  stats->length = v->realSize;
+  stats->capacity = v->allocSpace;
+  stats->bytesUsed = (long) v->realSize * v->elemSize;
+  stats->bytesReserved = HeapBytes(v);
+  stats->numReallocs = v->numReallocs;
+}
+
+void VectorGlobalStats(vectorGlobalStats *stats)
+{
+  assert(stats!=NULL);
+  stats->bytesReserved = __atomic_load_n(&globalStats.bytesReserved, __ATOMIC_RELAXED);
+  stats->peakBytesReserved = __atomic_load_n(&globalStats.peakBytesReserved, __ATOMIC_RELAXED);
+  stats->numAllocations = __atomic_load_n(&globalStats.numAllocations, __ATOMIC_RELAXED);
+  stats->numReallocs = __atomic_load_n(&globalStats.numReallocs, __ATOMIC_RELAXED);
+  stats->numFrees = __atomic_load_n(&globalStats.numFrees, __ATOMIC_RELAXED);
 }
 
 static const int kNotFound = -1;
@@ -158,7 +435,7 @@ int VectorSearch(const vector *v, const void *key, VectorCompareFunction searchF
   assert (startIndex >=0);
 
 
-  void * start =  (char*)v->dataP+startIndex*v->elemSize;
+  void * start =  Elements(v)+startIndex*v->elemSize;
   size_t size = v->realSize-startIndex;
   char* position;
   
@@ -168,7 +445,7 @@ int VectorSearch(const vector *v, const void *key, VectorCompareFunction searchF
     position = lfind(key, start, &size,v->elemSize, searchFn);
     
   if(position !=NULL)
-    return(position - (char*)v->dataP)/v->elemSize;
+    return(position - Elements(v))/v->elemSize;
    
   return kNotFound;
 
@@ -17,6 +17,7 @@
 #define _vector_
 
 #include "bool.h"
+#include "allocator.h"
 
 /**
  * Type: VectorCompareFunction
@@ -71,9 +72,16 @@ typedef struct {
   int elemSize;
   int allocSpace;
   int realSize;
-  void* dataP;
+  int numReallocs;		// times the elements have been moved to a bigger block
+  void* dataP;			// NULL for as long as the elements fit in inlineElems
   VectorFreeFunction freeFn;
-  // to be filled in by you
+  const allocator *alloc;	// NULL means malloc, realloc, and free
+  union {			// the first few elements live right here, with no heap block at all
+    char bytes[24];
+    void *alignPointer;
+    long long alignLongLong;
+    double alignDouble;
+  } inlineElems;
 } vector;
 
 /** 
@@ -124,10 +132,30 @@ typedef struct {
  * much of it.  If the client passes 0 for initialAllocation, the implementation
  * will use the default value of its own choosing.  As assert is raised is 
  * the initialAllocation value is less than 0.
+ *
+ * Every vector has room for 24 bytes' worth of elements (three char *s, say)
+ * built right into the vector struct, and a vector doesn't allocate any
+ * memory until it outgrows that space.  An initialAllocation that fits is
+ * satisfied without calling malloc at all, which makes lots of tiny vectors
+ * (like the buckets of a hashset) much cheaper.
  */
 
 void VectorNew(vector *v, int elemSize, VectorFreeFunction freefn, int initialAllocation);
 
+/**
+ * Function: VectorNewUsingAllocator
+ * ---------------------------------
+ * Operates exactly the same as VectorNew, except that the vector's memory
+ * comes from (and goes back to) the specified allocator rather than the heap.
+ * Passing NULL for alloc is the same as calling VectorNew.  The allocator
+ * needs to outlive the vector.
+ *
+ * The same asserts raised by VectorNew are raised here.
+ */
+
+void VectorNewUsingAllocator(vector *v, int elemSize, VectorFreeFunction freefn, int initialAllocation,
+			     const allocator *alloc);
+
 /**
  * Function: VectorDispose
  *           VectorDispose(&studentsDroppingTheCourse);
@@ -192,6 +220,61 @@ void VectorInsert(vector *v, const void *elemAddr, int position);
  */
 
 void VectorAppend(vector *v, const void *elemAddr);
+
+/**
+ * Function: VectorAppendMany
+ * --------------------------
+ * Appends numElements elements to the end of the specified vector, in order.
+ * The elements are laid out back to back starting at elemsAddr, exactly as
+ * they would be in a C array, and their contents are copied in with a single
+ * memcpy.  The vector grows at most once, so this is much cheaper than
+ * calling VectorAppend numElements times.
+ *
+ * An assert is raised if numElements is negative, or if elemsAddr is NULL
+ * while numElements is positive.
+ */
+
+void VectorAppendMany(vector *v, const void *elemsAddr, int numElements);
+
+/**
+ * Function: VectorReserve
+ * -----------------------
+ * Makes sure the vector has room for at least numElements elements, so that
+ * it needn't be reallocated until it grows beyond that.  The logical length
+ * is unaffected.  Clients that know how many elements they're about to append
+ * should call this first.  Pointers handed back by VectorNth are invalidated
+ * if the vector is reallocated.
+ *
+ * An assert is raised if numElements is negative.
+ */
+
+void VectorReserve(vector *v, int numElements);
+
+/**
+ * Function: VectorResize
+ * ----------------------
+ * Changes the logical length of the vector to newLength.  If the vector
+ * shrinks, the VectorFreeFunction supplied to VectorNew is levied against
+ * each of the elements being dropped.  If it grows, the new elements are
+ * zero-filled, ready for the client to fill in through VectorNth.
+ *
+ * An assert is raised if newLength is negative.
+ */
+
+void VectorResize(vector *v, int newLength);
+
+/**
+ * Function: VectorShrinkToFit
+ * ---------------------------
+ * Gives back whatever memory the vector holds beyond what its elements need.
+ * Neither VectorDelete nor VectorResize ever shrinks the allocation, so a vector
+ * that was once large keeps its peak footprint until this is called.  A vector
+ * whose elements fit in the inline buffer (see VectorNew) moves them back there
+ * and releases its heap block altogether.  Pointers handed back by VectorNth
+ * are invalidated.
+ */
+
+void VectorShrinkToFit(vector *v);
   
 /**
  * Function: VectorReplace
@@ -258,6 +341,25 @@ int VectorSearch(const vector *v, const void *key, VectorCompareFunction searchf
 
 void VectorSort(vector *v, VectorCompareFunction comparefn);
 
+/**
+ * Function: VectorSortIntegers
+ * ----------------------------
+ * Sorts a vector of signed integers (chars, shorts, ints, longs, or
+ * long longs) into ascending order.  It's a radix sort, so no comparator
+ * is needed and it runs in linear time: a byte at a time, skipping the
+ * bytes every element has in common (like the upper bytes of small
+ * numbers).  It needs a scratch buffer as large as the vector's contents,
+ * which comes from the vector's allocator (or the heap) for the duration
+ * of the call.  The sort is stable.
+ *
+ * For other element types, see vectorsort.h, which generates introsorts
+ * with inlined comparisons.
+ *
+ * An assert is raised unless the element size is 1, 2, 4, or 8.
+ */
+
+void VectorSortIntegers(vector *v);
+
 /**
  * Method: VectorMap
  * -----------------
@@ -271,4 +373,58 @@ void VectorSort(vector *v, VectorCompareFunction comparefn);
 
 void VectorMap(vector *v, VectorMapFunction mapfn, void *auxData);
 
+/**
+ * Type: vectorStats
+ * -----------------
+ * Snapshot of how much memory a vector is using, as filled in by
+ * VectorStats.  bytesReserved counts heap memory only, so it's 0 for
+ * a vector whose elements still fit in its inline buffer.
+ */
+
+typedef struct {
+  int length;           // number of elements
+  int capacity;         // number of elements there's room for
+  long bytesUsed;       // length times the element size
+  long bytesReserved;   // size of the heap block holding the elements
+  int numReallocs;      // times the elements were moved to a bigger block
+} vectorStats;
+
+/**
+ * Function: VectorStats
+ * ---------------------
+ * Fills in the vectorStats record addressed by stats with the specified
+ * vector's memory usage.  Runs in constant time.  The gap between
+ * bytesReserved and bytesUsed is the price of over-allocation, and a
+ * large numReallocs suggests the initialAllocation passed to VectorNew
+ * (or a call to VectorReserve) could have been bigger.
+ */
+
+void VectorStats(const vector *v, vectorStats *stats);
+
+/**
+ * Type: vectorGlobalStats
+ * -----------------------
+ * Memory accounting for every vector in the program taken together,
+ * as filled in by VectorGlobalStats.  Vectors whose memory comes from an
+ * allocator (see VectorNewUsingAllocator) aren't counted.
+ */
+
+typedef struct {
+  long bytesReserved;     // heap memory currently held by all vectors
+  long peakBytesReserved; // the most heap memory ever held by all vectors at once
+  long numAllocations;    // heap blocks ever allocated (VectorSortIntegers' scratch buffers included)
+  long numReallocs;       // times a heap block was resized in place or moved
+  long numFrees;          // heap blocks ever freed, by VectorDispose, VectorShrinkToFit, or VectorSortIntegers
+} vectorGlobalStats;
+
+/**
+ * Function: VectorGlobalStats
+ * ---------------------------
+ * Fills in the vectorGlobalStats record addressed by stats.  It's safe to
+ * call while other threads are using vectors, although the fields are read
+ * one at a time, so they needn't add up exactly when that happens.
+ */
+
+void VectorGlobalStats(vectorGlobalStats *stats);
+
 #endif
@@ -0,0 +1,202 @@
+#include "vectorparallel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static const int kMinElemsPerThread = 8192;
+static const int kMapChunksPerThread = 4;
+
+/**
+ * Describes a single task's share of a parallel sort or map: the elements
+ * in [start, end) of the array at base.  A merge task instead merges the
+ * sorted runs [start, end) and [rightStart, rightEnd) of base into dest,
+ * starting at position destStart.
+ */
+
+typedef struct {
+  char *base;
+  int elemSize;
+  int start, end;
+  int rightStart, rightEnd;
+  char *dest;
+  int destStart;
+  VectorCompareFunction comparefn;
+  VectorMapFunction mapfn;
+  void *auxData;
+} vectorSlice;
+
+static void SortSlice(void *data)
+{
+  vectorSlice *slice = data;
+  qsort(slice->base + slice->start * slice->elemSize, slice->end - slice->start,
+	slice->elemSize, slice->comparefn);
+}
+
+/**
+ * Merges the sorted runs [start, end) and [rightStart, rightEnd) into dest,
+ * starting at destStart.  Ties go to the first (left) run.
+ */
+
+static void MergeSlice(void *data)
+{
+  vectorSlice *slice = data;
+  int elemSize = slice->elemSize;
+  char *left = slice->base + slice->start * elemSize, *leftEnd = slice->base + slice->end * elemSize;
+  char *right = slice->base + slice->rightStart * elemSize, *rightEnd = slice->base + slice->rightEnd * elemSize;
+  char *dest = slice->dest + slice->destStart * elemSize;
+
+  while (left < leftEnd && right < rightEnd) {
+    if (slice->comparefn(right, left) < 0) {
+      memcpy(dest, right, elemSize);
+      right += elemSize;
+    } else {
+      memcpy(dest, left, elemSize);
+      left += elemSize;
+    }
+    dest += elemSize;
+  }
+
+  memcpy(dest, left, leftEnd - left);
+  memcpy(dest + (leftEnd - left), right, rightEnd - right);
+}
+
+/**
+ * Returns how many of the first numMerged elements of the merge of the sorted
+ * runs left[0, numLeft) and right[0, numRight) come from the left run, given
+ * that ties go to the left run.  Cutting both runs there splits the merge
+ * into two halves that can be carried out independently, which is how a
+ * single big merge gets shared among several threads.  The answer is
+ * binary searched for: it's the smallest count i for which the element
+ * right[numMerged - i - 1] (the last one taken from the right run) comes
+ * strictly before left[i] (the first one left behind in the left run).
+ */
+
+static int LeftShareOfMerge(const char *left, int numLeft, const char *right, int numRight,
+			    int numMerged, int elemSize, VectorCompareFunction comparefn)
+{
+  int low = (numMerged > numRight) ? numMerged - numRight : 0;
+  int high = (numMerged < numLeft) ? numMerged : numLeft;
+  while (low < high) {
+    int i = low + (high - low) / 2, j = numMerged - i;
+    if (comparefn(right + (j - 1) * elemSize, left + i * elemSize) >= 0)
+      low = i + 1;  // left[i] belongs before right[j - 1], so more of the left run is needed
+    else
+      high = i;
+  }
+
+  return low;
+}
+
+/**
+ * Merges the runs [first, mid) and [mid, last) of from into the same positions
+ * of to, as numPieces tasks that each produce an equal share of the output.
+ */
+
+static void ScheduleMerge(threadpool *pool, threadpoolGroup *group, vectorSlice *pieces, int numPieces,
+			  char *from, char *to, int first, int mid, int last,
+			  int elemSize, VectorCompareFunction comparefn)
+{
+  char *left = from + (size_t) first * elemSize, *right = from + (size_t) mid * elemSize;
+  int numLeft = mid - first, numRight = last - mid;
+  int leftCut = 0, rightCut = 0;
+  for (int i = 0; i < numPieces; i++) {
+    int numMerged = (int) ((long long) (numLeft + numRight) * (i + 1) / numPieces);
+    int nextLeftCut = LeftShareOfMerge(left, numLeft, right, numRight, numMerged, elemSize, comparefn);
+    int nextRightCut = numMerged - nextLeftCut;
+    pieces[i] = (vectorSlice) { .base = from, .elemSize = elemSize,
+				.start = first + leftCut, .end = first + nextLeftCut,
+				.rightStart = mid + rightCut, .rightEnd = mid + nextRightCut,
+				.dest = to, .destStart = first + leftCut + rightCut, .comparefn = comparefn };
+    ThreadPoolScheduleInGroup(pool, group, MergeSlice, &pieces[i]);
+    leftCut = nextLeftCut;
+    rightCut = nextRightCut;
+  }
+}
+
+void VectorParallelSort(vector *v, VectorCompareFunction comparefn, threadpool *pool)
+{
+  assert(comparefn != NULL);
+  assert(pool != NULL);
+  int n = VectorLength(v);
+  int numRuns = 1;
+  while (numRuns < ThreadPoolNumThreads(pool) && n / (2 * numRuns) >= kMinElemsPerThread)
+    numRuns *= 2;
+  if (numRuns == 1) {
+    VectorSort(v, comparefn);
+    return;
+  }
+
+  vectorSlice slices[numRuns];
+  int boundaries[numRuns + 1];
+  for (int i = 0; i <= numRuns; i++)
+    boundaries[i] = (int) ((long long) n * i / numRuns);
+
+  threadpoolGroup group;
+  ThreadPoolGroupNew(&group);
+  char *elems = VectorNth(v, 0);
+  for (int i = 0; i < numRuns; i++) {
+    slices[i] = (vectorSlice) { .base = elems, .elemSize = v->elemSize,
+				.start = boundaries[i], .end = boundaries[i + 1], .comparefn = comparefn };
+    ThreadPoolScheduleInGroup(pool, &group, SortSlice, &slices[i]);
+  }
+  ThreadPoolGroupWait(pool, &group);
+
+  // merge neighboring runs, a round at a time, bouncing between the vector and the scratch buffer.
+  // Every round is cut into numRuns pieces, so all of the threads stay busy even once there are
+  // fewer merges than threads.
+  char *scratch = malloc((size_t) n * v->elemSize);
+  assert(scratch != NULL);
+  char *from = elems, *to = scratch;
+  for (int width = 1; width < numRuns; width *= 2) {
+    int numMerges = numRuns / (2 * width);
+    for (int i = 0; i < numMerges; i++) {
+      int first = 2 * i * width;
+      ScheduleMerge(pool, &group, &slices[first], 2 * width, from, to, boundaries[first],
+		    boundaries[first + width], boundaries[first + 2 * width], v->elemSize, comparefn);
+    }
+    ThreadPoolGroupWait(pool, &group);
+
+    char *swap = from;
+    from = to;
+    to = swap;
+  }
+
+  if (from != elems)
+    memcpy(elems, from, (size_t) n * v->elemSize);
+  free(scratch);
+  ThreadPoolGroupDispose(&group);
+}
+
+static void MapSlice(void *data)
+{
+  vectorSlice *slice = data;
+  for (int i = slice->start; i < slice->end; i++)
+    slice->mapfn(slice->base + i * slice->elemSize, slice->auxData);
+}
+
+void VectorParallelMap(vector *v, VectorMapFunction mapfn, void *auxData, threadpool *pool)
+{
+  assert(mapfn != NULL);
+  assert(pool != NULL);
+  int n = VectorLength(v);
+  int numChunks = kMapChunksPerThread * ThreadPoolNumThreads(pool);
+  if (numChunks > n) numChunks = n;
+  if (numChunks <= 1) {
+    VectorMap(v, mapfn, auxData);
+    return;
+  }
+
+  vectorSlice slices[numChunks];
+  threadpoolGroup group;
+  ThreadPoolGroupNew(&group);
+  char *elems = VectorNth(v, 0);
+  for (int i = 0; i < numChunks; i++) {
+    slices[i] = (vectorSlice) { .base = elems, .elemSize = v->elemSize,
+				.start = (int) ((long long) n * i / numChunks),
+				.end = (int) ((long long) n * (i + 1) / numChunks),
+				.mapfn = mapfn, .auxData = auxData };
+    ThreadPoolScheduleInGroup(pool, &group, MapSlice, &slices[i]);
+  }
+  ThreadPoolGroupWait(pool, &group);
+  ThreadPoolGroupDispose(&group);
+}
@@ -0,0 +1,54 @@
+#ifndef _vectorparallel_
+#define _vectorparallel_
+#include "vector.h"
+#include "threadpool.h"
+
+/* File: vectorparallel.h
+ * ----------------------
+ * Versions of VectorSort and VectorMap that spread the work over the
+ * worker threads of a threadpool.  They take the very same comparators
+ * and mapping functions as their sequential counterparts.  They live
+ * apart from vector.h so that single-threaded clients of the vector
+ * needn't link against the pthreads library.
+ *
+ * Neither function is a thread-safe version of anything: no other thread
+ * may touch the vector until the call returns.
+ */
+
+/**
+ * Function: VectorParallelSort
+ * ----------------------------
+ * Sorts the vector into ascending order according to the supplied comparator,
+ * just as VectorSort does.  The vector is cut into one run per worker thread
+ * (rounded up to a power of two), the runs are sorted at the same time, and
+ * then pairs of runs are merged, a round at a time, until one sorted run
+ * remains.  Each round is cut into one piece per run, so even the final
+ * merge is shared among all of the threads.  The call waits only on the
+ * tasks it scheduled itself, so other clients may share the pool.  Short
+ * vectors are just handed to VectorSort.  The merging needs
+ * a scratch buffer as large as the vector's contents.  The comparator must
+ * be safe to call from several threads at once.
+ *
+ * An assert is raised if the comparator or the pool is NULL.
+ */
+
+void VectorParallelSort(vector *v, VectorCompareFunction comparefn, threadpool *pool);
+
+/**
+ * Function: VectorParallelMap
+ * ---------------------------
+ * Calls mapfn on every element of the vector, just as VectorMap does,
+ * except that the vector is cut into contiguous chunks that are mapped
+ * over by different threads at the same time.  Each element is still
+ * visited exactly once, but there's no telling which elements are
+ * visited in what order, so mapfn must be safe to call on different
+ * elements from several threads at once (and should treat auxData
+ * accordingly).  The call returns once every element has been visited,
+ * without waiting on any unrelated tasks in the pool.
+ *
+ * An assert is raised if mapfn or the pool is NULL.
+ */
+
+void VectorParallelMap(vector *v, VectorMapFunction mapfn, void *auxData, threadpool *pool);
+
+#endif
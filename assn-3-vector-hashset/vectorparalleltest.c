@@ -0,0 +1,153 @@
+#include "vectorparallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <assert.h>
+
+/**
+ * Function: WallClockSeconds
+ * --------------------------
+ * clock() adds up the processor time of every thread, which is exactly
+ * the wrong thing to measure when the point is to use several of them
+ * at once, so the timings below go by the wall clock.
+ */
+
+static double WallClockSeconds(void)
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec / 1e6;
+}
+
+static int LongCompare(const void *vp1, const void *vp2)
+{
+  long one = *(const long *) vp1, two = *(const long *) vp2;
+  return (one > two) - (one < two);
+}
+
+static void FillWithPermutation(vector *numbers, long n, long d)
+{
+  for (long k = 0; k < d; k++) {
+    long residue = (long) (((long long) k * (long long) n) % d);
+    VectorAppend(numbers, &residue);
+  }
+}
+
+/**
+ * Function: TestParallelSort
+ * --------------------------
+ * Sorts the same large permutation with VectorSort and with VectorParallelSort,
+ * reports both times, and confirms the parallel sort got it right.  Vectors of
+ * awkward lengths (including ones too short to be worth splitting up) are
+ * checked as well.
+ */
+
+static const long kLargePrime = 1398269;
+static const long kEvenLargerPrime = 3021377;
+static void TestParallelSort(threadpool *pool)
+{
+  fprintf(stdout, " ------------------------- Starting the parallel sort test (%d threads)\n",
+	  ThreadPoolNumThreads(pool));
+  long lengths[] = { 0, 1, 2, 8191, 16384, 65537, 100003 };
+  for (int i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    vector numbers;
+    VectorNew(&numbers, sizeof(long), NULL, 4);
+    for (long k = 0; k < lengths[i]; k++) {
+      long number = rand() % 1000 - 500;
+      VectorAppend(&numbers, &number);
+    }
+    VectorParallelSort(&numbers, LongCompare, pool);
+    for (int k = 1; k < VectorLength(&numbers); k++)
+      assert(*(long *) VectorNth(&numbers, k - 1) <= *(long *) VectorNth(&numbers, k));
+    VectorDispose(&numbers);
+  }
+
+  vector sequential, parallel;
+  VectorNew(&sequential, sizeof(long), NULL, kEvenLargerPrime);
+  VectorNew(&parallel, sizeof(long), NULL, kEvenLargerPrime);
+  FillWithPermutation(&sequential, kLargePrime, kEvenLargerPrime);
+  FillWithPermutation(&parallel, kLargePrime, kEvenLargerPrime);
+
+  double start = WallClockSeconds();
+  VectorSort(&sequential, LongCompare);
+  fprintf(stdout, "VectorSort sorted %ld longs in %.3f seconds.\n", kEvenLargerPrime, WallClockSeconds() - start);
+  start = WallClockSeconds();
+  VectorParallelSort(&parallel, LongCompare, pool);
+  fprintf(stdout, "VectorParallelSort sorted %ld longs in %.3f seconds.\n", kEvenLargerPrime, WallClockSeconds() - start);
+
+  for (long k = 0; k < kEvenLargerPrime; k++)
+    assert(*(long *) VectorNth(&parallel, k) == k);
+  VectorDispose(&sequential);
+  VectorDispose(&parallel);
+}
+
+/**
+ * Function: Collatz
+ * -----------------
+ * Mapping function that replaces a number with the number of steps its
+ * Collatz sequence takes to reach 1: busywork that's the same no matter
+ * which thread does it, and that's easy to check afterwards.
+ */
+
+static void Collatz(void *elem, void *auxData)
+{
+  long *number = elem;
+  long value = *number, steps = 0;
+  while (value > 1) {
+    value = (value % 2 == 0) ? value / 2 : 3 * value + 1;
+    steps++;
+  }
+  *number = steps;
+}
+
+/**
+ * Function: TestParallelMap
+ * -------------------------
+ * Maps Collatz over two copies of the same vector, one with VectorMap and
+ * one with VectorParallelMap, reports both times, and checks the results
+ * agree element for element.
+ */
+
+static const long kNumCollatzNumbers = 1000000;
+static void TestParallelMap(threadpool *pool)
+{
+  vector sequential, parallel;
+  fprintf(stdout, "\n\n ------------------------- Starting the parallel map test (%d threads)\n",
+	  ThreadPoolNumThreads(pool));
+  VectorNew(&sequential, sizeof(long), NULL, kNumCollatzNumbers);
+  VectorNew(&parallel, sizeof(long), NULL, kNumCollatzNumbers);
+  for (long k = 1; k <= kNumCollatzNumbers; k++) {
+    VectorAppend(&sequential, &k);
+    VectorAppend(&parallel, &k);
+  }
+
+  double start = WallClockSeconds();
+  VectorMap(&sequential, Collatz, NULL);
+  fprintf(stdout, "VectorMap mapped over %ld longs in %.3f seconds.\n", kNumCollatzNumbers, WallClockSeconds() - start);
+  start = WallClockSeconds();
+  VectorParallelMap(&parallel, Collatz, NULL, pool);
+  fprintf(stdout, "VectorParallelMap mapped over %ld longs in %.3f seconds.\n", kNumCollatzNumbers, WallClockSeconds() - start);
+
+  for (long k = 0; k < kNumCollatzNumbers; k++)
+    assert(*(long *) VectorNth(&sequential, k) == *(long *) VectorNth(&parallel, k));
+  VectorDispose(&sequential);
+  VectorDispose(&parallel);
+}
+
+/**
+ * Function: main
+ * --------------
+ * Runs both tests on a pool with as many threads as there are processors,
+ * unless some other number of threads is given on the command line.
+ */
+
+int main(int argc, char **argv)
+{
+  threadpool pool;
+  ThreadPoolNew(&pool, (argc > 1) ? atoi(argv[1]) : 0);
+  TestParallelSort(&pool);
+  TestParallelMap(&pool);
+  ThreadPoolDispose(&pool);
+  return 0;
+}
@@ -0,0 +1,167 @@
+#ifndef _vectorsort_
+#define _vectorsort_
+#include "vector.h"
+#include <assert.h>
+
+/* File: vectorsort.h
+ * ------------------
+ * Generates sort and search routines specialized for vectors of
+ * one particular element type.
+ *
+ * VectorSort and VectorSearch call the client's comparator through a
+ * function pointer once per comparison, and they know nothing about
+ * the elements beyond their size, so every element gets moved around
+ * with a memcpy.  The macros below stamp out routines for a specific
+ * type instead.  The comparison is a macro or inline function, so the
+ * compiler inlines it, and elements are moved by plain assignment.
+ * For example:
+ *
+ *    #define LongLess(a, b) ((a) < (b))
+ *    VECTOR_DEFINE_SORT(SortLongs, long, LongLess)
+ *    VECTOR_DEFINE_SEARCH(SearchLongs, long, LongLess)
+ *
+ * defines
+ *
+ *    static void SortLongs(vector *v);
+ *    static int SearchLongs(const vector *v, long key);
+ *
+ * The lessThan argument is handed two elements (not their addresses), and
+ * must evaluate to nonzero if and only if the first belongs strictly before
+ * the second.  It may evaluate its arguments more than once.  Vectors of
+ * integers can also be sorted with VectorSortIntegers (see vector.h), which
+ * needs no comparison at all.
+ */
+
+/**
+ * Macro: VECTOR_DEFINE_SORT
+ * -------------------------
+ * Defines static void name(vector *v), which sorts a vector of type elements
+ * into ascending order as dictated by lessThan.  It's an introsort: a
+ * median-of-three quicksort that switches over to heapsort if the recursion
+ * gets suspiciously deep, and leaves short runs to a final insertion sort.
+ * That keeps it O(n log n) in the worst case.  The sort isn't stable.
+ *
+ * An assert is raised if sizeof(type) isn't the vector's element size.
+ */
+
+#define VECTOR_DEFINE_SORT(name, type, lessThan)				\
+  static void name##SiftDown(type *elems, int root, int n)			\
+  {										\
+    type value = elems[root];							\
+    while (2 * root + 1 < n) {							\
+      int child = 2 * root + 1;							\
+      if (child + 1 < n && lessThan(elems[child], elems[child + 1])) child++;	\
+      if (!lessThan(value, elems[child])) break;				\
+      elems[root] = elems[child];						\
+      root = child;								\
+    }										\
+    elems[root] = value;							\
+  }										\
+										\
+  static void name##HeapSort(type *elems, int n)				\
+  {										\
+    for (int i = n / 2 - 1; i >= 0; i--)					\
+      name##SiftDown(elems, i, n);						\
+    for (int last = n - 1; last > 0; last--) {					\
+      type largest = elems[0];							\
+      elems[0] = elems[last];							\
+      elems[last] = largest;							\
+      name##SiftDown(elems, 0, last);						\
+    }										\
+  }										\
+										\
+  static void name##Introsort(type *elems, int n, int depthLimit)		\
+  {										\
+    while (n > 16) {								\
+      if (depthLimit-- == 0) {							\
+	name##HeapSort(elems, n);						\
+	return;									\
+      }										\
+										\
+      type *lo = elems, *mid = elems + n / 2, *hi = elems + n - 1, swap;	\
+      if (lessThan(*mid, *lo)) { swap = *mid; *mid = *lo; *lo = swap; }	\
+      if (lessThan(*hi, *mid)) { swap = *hi; *hi = *mid; *mid = swap; }	\
+      if (lessThan(*mid, *lo)) { swap = *mid; *mid = *lo; *lo = swap; }	\
+      type pivot = *mid;							\
+										\
+      type *left = lo + 1, *right = hi - 1;					\
+      while (true) {								\
+	while (lessThan(*left, pivot)) left++;					\
+	while (lessThan(pivot, *right)) right--;				\
+	if (left >= right) break;						\
+	swap = *left; *left = *right; *right = swap;				\
+	left++;									\
+	right--;								\
+      }										\
+										\
+      int numLeft = right - elems + 1;						\
+      if (numLeft < n - numLeft) {						\
+	name##Introsort(elems, numLeft, depthLimit);				\
+	elems += numLeft;							\
+	n -= numLeft;								\
+      } else {									\
+	name##Introsort(elems + numLeft, n - numLeft, depthLimit);		\
+	n = numLeft;								\
+      }										\
+    }										\
+  }										\
+										\
+  static void name##InsertionSort(type *elems, int n)				\
+  {										\
+    for (int i = 1; i < n; i++) {						\
+      type value = elems[i];							\
+      int j = i;								\
+      for (; j > 0 && lessThan(value, elems[j - 1]); j--)			\
+	elems[j] = elems[j - 1];						\
+      elems[j] = value;								\
+    }										\
+  }										\
+										\
+  static void name(vector *v)							\
+  {										\
+    assert(v->elemSize == sizeof(type));					\
+    int n = VectorLength(v);							\
+    if (n < 2) return;								\
+    int depthLimit = 0;								\
+    for (int size = n; size > 1; size /= 2) depthLimit += 2;			\
+    type *elems = VectorNth(v, 0);						\
+    name##Introsort(elems, n, depthLimit);					\
+    name##InsertionSort(elems, n);						\
+  }
+
+/**
+ * Macro: VECTOR_DEFINE_SEARCH
+ * ---------------------------
+ * Defines static int name(const vector *v, type key), which binary searches
+ * a vector of type elements already sorted into ascending order by lessThan,
+ * and returns the position of an element equivalent to key (neither one less
+ * than the other), or -1 if there isn't one.  If several elements match, the
+ * first of them is the one identified.
+ *
+ * The search is branchless: every iteration halves the range with a
+ * conditional move rather than a conditional jump, so there are no
+ * mispredicted branches to pay for, and the number of iterations
+ * depends only on the length of the vector.
+ *
+ * An assert is raised if sizeof(type) isn't the vector's element size.
+ */
+
+#define VECTOR_DEFINE_SEARCH(name, type, lessThan)				\
+  static int name(const vector *v, type key)					\
+  {										\
+    assert(v->elemSize == sizeof(type));					\
+    int n = VectorLength(v);							\
+    if (n == 0) return -1;							\
+    const type *elems = VectorNth(v, 0), *base = elems;				\
+    while (n > 1) {								\
+      int half = n / 2;								\
+      base = lessThan(base[half], key) ? base + half : base;			\
+      n -= half;								\
+    }										\
+    int position = (base - elems) + (lessThan(*base, key) ? 1 : 0);		\
+    if (position == VectorLength(v) || lessThan(key, elems[position]))		\
+      return -1;								\
+    return position;								\
+  }
+
+#endif
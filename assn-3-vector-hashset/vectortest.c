@@ -1,4 +1,5 @@
 #include "vector.h"
+#include "vectorsort.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -292,8 +293,19 @@ static void DeleteEverythingVerySlowly(vector *numbers)
     VectorDelete(numbers, VectorLength(numbers) - 100);
     assert(largestOriginalNumber == *(long *)VectorNth(numbers, VectorLength(numbers) -1));
   }
+  
+  vectorStats stats;
+  VectorShrinkToFit(numbers);
+  VectorStats(numbers, &stats);
+  assert(stats.capacity == VectorLength(numbers) && stats.bytesReserved == stats.bytesUsed);
+  assert(largestOriginalNumber == *(long *)VectorNth(numbers, VectorLength(numbers) -1));
   fprintf(stdout, "\t[Okay, almost done... deleting the last 100 elements... ");
   fflush(stdout);
+  while (VectorLength(numbers) > 2) VectorDelete(numbers, 0);
+  VectorShrinkToFit(numbers);
+  VectorStats(numbers, &stats);
+  assert(stats.bytesReserved == 0); // two longs fit in the inline buffer
+  assert(largestOriginalNumber == *(long *)VectorNth(numbers, 1));
   while (VectorLength(numbers) > 0) VectorDelete(numbers, 0);
   fprintf(stdout, "and we're all done... whew!]\n");
   fflush(stdout);
@@ -325,6 +337,163 @@ static void ChallengingTest()
   VectorDispose(&lotsOfNumbers);
 }
 
+/**
+ * Function: BulkTest
+ * ------------------
+ * Builds the same permutation as ChallengingTest, first one VectorAppend
+ * at a time (courtesy of InsertPermutationOfNumbers) and then with a single
+ * VectorAppendMany into a vector that's been reserved up front.  The two
+ * vectors had better agree.  It then
+ * shrinks and regrows the vector with VectorResize to confirm that the
+ * dropped elements are gone and the new ones are zero-filled.
+ */
+
+static void BulkTest()
+{
+  vector oneAtATime, allAtOnce;
+  fprintf(stdout, "\n\n------------------------- Starting the bulk append test...\n");
+  VectorNew(&oneAtATime, sizeof(long), NULL, 4);
+  InsertPermutationOfNumbers(&oneAtATime, kLargePrime, kEvenLargerPrime);
+
+  long *residues = malloc(kEvenLargerPrime * sizeof(long));
+  assert(residues != NULL);
+  for (long k = 0; k < kEvenLargerPrime; k++)
+    residues[k] = (long) (((long long) k * (long long) kLargePrime) % kEvenLargerPrime);
+  
+  VectorNew(&allAtOnce, sizeof(long), NULL, 4);
+  VectorReserve(&allAtOnce, kEvenLargerPrime);
+  VectorAppendMany(&allAtOnce, residues, kEvenLargerPrime);
+  free(residues);
+
+  assert(VectorLength(&allAtOnce) == VectorLength(&oneAtATime));
+  for (int i = 0; i < VectorLength(&allAtOnce); i++)
+    assert(*(long *) VectorNth(&allAtOnce, i) == *(long *) VectorNth(&oneAtATime, i));
+  fprintf(stdout, "VectorAppend and VectorReserve + VectorAppendMany build the same vector.\n");
+
+  long first = *(long *) VectorNth(&allAtOnce, 1);
+  VectorResize(&allAtOnce, 2);
+  VectorResize(&allAtOnce, 100);
+  assert(VectorLength(&allAtOnce) == 100);
+  assert(*(long *) VectorNth(&allAtOnce, 1) == first);
+  for (int i = 2; i < 100; i++)
+    assert(*(long *) VectorNth(&allAtOnce, i) == 0);
+  fprintf(stdout, "VectorResize shrinks and zero-fills as expected.\n");
+
+  VectorDispose(&oneAtATime);
+  VectorDispose(&allAtOnce);
+}
+
+/**
+ * Function: SortAndSearchTest
+ * ---------------------------
+ * Checks the introsort generated by VECTOR_DEFINE_SORT and VectorSortIntegers
+ * (radix sort) against VectorSort on vectors full of negative numbers and
+ * duplicates, and then on the same permutation ChallengingTest uses.  It then
+ * searches the sorted permutation for every one of its elements (and for
+ * numbers that aren't there) with VectorSearch and with the branchless search
+ * generated by VECTOR_DEFINE_SEARCH.  container-bench times all of them.
+ */
+
+#define LongLess(a, b) ((a) < (b))
+VECTOR_DEFINE_SORT(SortLongs, long, LongLess)
+VECTOR_DEFINE_SEARCH(SearchLongs, long, LongLess)
+
+static int ShortCompare(const void *vp1, const void *vp2)
+{
+  return (*(const short *)vp1) - (*(const short *)vp2);
+}
+
+static void CheckSortsAgree(int n, long range)
+{
+  vector expected, introsorted, radixSorted, shorts, sortedShorts;
+  VectorNew(&expected, sizeof(long), NULL, n);
+  VectorNew(&shorts, sizeof(short), NULL, n);
+  for (int i = 0; i < n; i++) {
+    long number = rand() % (2 * range + 1) - range;
+    short truncated = number;
+    VectorAppend(&expected, &number);
+    VectorAppend(&shorts, &truncated);
+  }
+  
+  VectorNew(&introsorted, sizeof(long), NULL, n);
+  VectorNew(&radixSorted, sizeof(long), NULL, n);
+  VectorNew(&sortedShorts, sizeof(short), NULL, n);
+  if (n > 0) {
+    VectorAppendMany(&introsorted, VectorNth(&expected, 0), n);
+    VectorAppendMany(&radixSorted, VectorNth(&expected, 0), n);
+    VectorAppendMany(&sortedShorts, VectorNth(&shorts, 0), n);
+  }
+  
+  VectorSort(&expected, LongCompare);
+  SortLongs(&introsorted);
+  VectorSortIntegers(&radixSorted);
+  VectorSort(&shorts, ShortCompare);
+  VectorSortIntegers(&sortedShorts);
+  for (int i = 0; i < n; i++) {
+    long number = *(long *) VectorNth(&expected, i);
+    assert(*(long *) VectorNth(&introsorted, i) == number);
+    assert(*(long *) VectorNth(&radixSorted, i) == number);
+    assert(*(short *) VectorNth(&sortedShorts, i) == *(short *) VectorNth(&shorts, i));
+    int found = SearchLongs(&expected, number);
+    assert(found >= 0 && found <= i && *(long *) VectorNth(&expected, found) == number);
+    assert(found == 0 || *(long *) VectorNth(&expected, found - 1) < number);
+  }
+  assert(SearchLongs(&expected, range + 1) == -1);
+  assert(SearchLongs(&expected, -range - 1) == -1);
+  
+  VectorDispose(&expected);
+  VectorDispose(&introsorted);
+  VectorDispose(&radixSorted);
+  VectorDispose(&shorts);
+  VectorDispose(&sortedShorts);
+}
+
+static void SortAndSearchTest()
+{
+  fprintf(stdout, "\n\n------------------------- Starting the sort and search test...\n");
+  int sizes[] = { 0, 1, 2, 15, 16, 17, 100, 1000, 100000 };
+  for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    CheckSortsAgree(sizes[i], 10);
+    CheckSortsAgree(sizes[i], LONG_MAX / 4);
+  }
+  fprintf(stdout, "All three sorts agree on vectors with negative numbers and duplicates.\n");
+  
+  vector viaQsort, viaIntrosort, viaRadixSort;
+  VectorNew(&viaQsort, sizeof(long), NULL, kEvenLargerPrime);
+  for (long k = 0; k < kEvenLargerPrime; k++) {
+    long residue = (long) (((long long) k * (long long) kLargePrime) % kEvenLargerPrime);
+    VectorAppend(&viaQsort, &residue);
+  }
+  VectorNew(&viaIntrosort, sizeof(long), NULL, kEvenLargerPrime);
+  VectorNew(&viaRadixSort, sizeof(long), NULL, kEvenLargerPrime);
+  VectorAppendMany(&viaIntrosort, VectorNth(&viaQsort, 0), kEvenLargerPrime);
+  VectorAppendMany(&viaRadixSort, VectorNth(&viaQsort, 0), kEvenLargerPrime);
+  
+  VectorSort(&viaQsort, LongCompare);
+  SortLongs(&viaIntrosort);
+  VectorSortIntegers(&viaRadixSort);
+  for (long k = 0; k < kEvenLargerPrime; k++) {
+    assert(*(long *) VectorNth(&viaQsort, k) == k);
+    assert(*(long *) VectorNth(&viaIntrosort, k) == k);
+    assert(*(long *) VectorNth(&viaRadixSort, k) == k);
+  }
+  fprintf(stdout, "All three sorts put the %ld-long permutation back in order.\n", kEvenLargerPrime);
+  
+  long viaBsearch = 0, viaBranchless = 0;
+  for (long k = -kLargePrime; k < kEvenLargerPrime; k++) {
+    int position = VectorSearch(&viaQsort, &k, LongCompare, 0, true);
+    viaBsearch += position >= 0;
+    viaBranchless += SearchLongs(&viaQsort, k) == position;
+  }
+  assert(viaBsearch == kEvenLargerPrime);
+  assert(viaBranchless == kEvenLargerPrime + kLargePrime);
+  fprintf(stdout, "VectorSearch and the branchless search agree on every lookup.\n");
+  
+  VectorDispose(&viaQsort);
+  VectorDispose(&viaIntrosort);
+  VectorDispose(&viaRadixSort);
+}
+
 /** 
  * Function: FreeString
  * --------------------
@@ -408,6 +577,8 @@ int main(int ignored, char **alsoIgnored)
 {
   SimpleTest();
   ChallengingTest();
+  BulkTest();
+  SortAndSearchTest();
   MemoryTest();
   return 0;
 }
@@ -725,7 +725,7 @@ static const signed long kHashMultiplier = -1664117991L;
 static int StringHash(const void *elemAddr, int numBuckets){
   char* s = *(char**)elemAddr;
   unsigned long hashcode = 0;
-  for (int i = 0; i < strlen(s); i++)
+  for (int i = 0; s[i] != '\0'; i++)
     hashcode = hashcode * kHashMultiplier + tolower(s[i]);
   return hashcode % numBuckets;
 }
@@ -12,12 +12,14 @@
 #include "html-utils.h"
 #include "vector.h"
 #include "hashset.h"
+#include "concurrenthashset.h"
+#include "stringpool.h"
+#include "arena.h"
 
 #include "pthread.h" //#include "thread_107.h"
 #include "semaphore.h"
 
 typedef struct{
-  pthread_mutex_t indicesHashSetLock; 
   pthread_mutex_t articlesVectorLock; 
   pthread_mutex_t stopWordsHashSetLock; 
   sem_t connectionsLock; 
@@ -25,9 +27,16 @@ typedef struct{
   hashset limitConnToServerLock; //char* and sem_t *
 }semafores;
 
+// every string the database holds onto long term lives in here
 typedef struct {
+  stringpool pool;
+  pthread_mutex_t lock;
+} internedStrings;
+
+typedef struct {
+  internedStrings strings;
   hashset stopWords;
-  hashset indices;
+  concurrenthashset indices;
   vector previouslySeenArticles;
   semafores locks;
   vector threads;
@@ -63,8 +72,8 @@ typedef struct {
 // Next 3 are thread parametrs and thread storing structs
 typedef struct {
   rssDatabase *db;
-  char *title;
-  char *URL;
+  const char *title;
+  const char *URL;
 }threadArguments;
 
 typedef struct {
@@ -78,7 +87,7 @@ typedef struct{
 }serverLockData;
 
 static void Welcome(const char *welcomeTextURL);
-static void LoadStopWords(hashset *stopWords, const char *stopWordsURL);
+static void LoadStopWords(hashset *stopWords, internedStrings *strings, const char *stopWordsURL);
 static void BuildIndices(rssDatabase *db, const char *feedsFileName);
 static void ProcessFeed(rssDatabase *db, const char *remoteDocumentName);
 static void PullAllNewsItems(rssDatabase *db, urlconnection *urlconn);
@@ -91,10 +100,14 @@ static void NewThreadParseArticle(rssDatabase *db, const char *articleTitle, con
 static void* PthreadParseArticle(void * threadData);
 static void ParseArticle(rssDatabase *db, const char *articleTitle, const char *articleURL);
 
-static void ScanArticle(streamtokenizer *st, int articleID, hashset *indices, hashset *stopWords, 
-			 pthread_mutex_t* indicesLock, pthread_mutex_t* stopWordsLock);
+static void ScanArticle(streamtokenizer *st, int articleID, concurrenthashset *indices, hashset *stopWords, 
+			 pthread_mutex_t* stopWordsLock, internedStrings *strings);
 static bool WordIsWorthIndexing(const char *word, hashset *stopWords);
-static void AddWordToIndices(hashset *indices, const char *word, int articleIndex);
+static void TallyWord(hashset *tallies, arena *articleMemory, const char *word);
+static void FlushWordTally(void *elem, void *auxData);
+static void AddWordToIndices(concurrenthashset *indices, internedStrings *strings, const char *word,
+			     int articleIndex, int freq);
+static void RecordWordOccurrence(void *elem, bool inserted, void *auxData);
 static void QueryIndices(rssDatabase *db);
 static void ProcessResponse(rssDatabase *db, const char *word);
 static void ListTopArticles(rssIndexEntry *index, vector *previouslySeenArticles);
@@ -102,17 +115,35 @@ static bool WordIsWellFormed(const char *word);
 
 static int StringHash(const void *elem, int numBuckets);
 static int StringCompare(const void *elem1, const void *elem2);
-static void StringFree(void *elem);
+static void InternedStringsNew(internedStrings *strings);
+static void InternedStringsDispose(internedStrings *strings);
+static const char *InternString(internedStrings *strings, const char *s);
 
-static void NewsArticleClone(rssNewsArticle *article, const char *title, 
+static void NewsArticleClone(rssNewsArticle *article, internedStrings *strings, const char *title, 
 			     const char *server, const char *fullURL);
 static int NewsArticleCompare(const void *elem1, const void *elem2);
-static void NewsArticleFree(void *elem);
 
 static int IndexEntryHash(const void *elem, int numBuckets);
 static int IndexEntryCompare(const void *elem1, const void *elem2);
 static void IndexEntryFree(void *elem);
 
+typedef struct {
+  const char *word;  // copied into the article's arena
+  int freq;
+} wordTally;
+
+typedef struct {
+  internedStrings *strings;
+  int articleIndex;
+  int freq;
+} wordOccurrence;
+
+typedef struct {
+  concurrenthashset *indices;
+  internedStrings *strings;
+  int articleIndex;
+} articleTallies;
+
 static int ArticleIndexCompare(const void *elem1, const void *elem2);
 static int ArticleFrequencyCompare(const void *elem1, const void *elem2);
 
@@ -124,7 +155,7 @@ static void initThreadsData(rssDatabase *db);
 static void cleanThreadData(rssDatabase *db);
 static void unlockConnection(rssDatabase *db, const char* serverURL);
 static void lockConnection(rssDatabase *db, const char* serverURL);
-static sem_t* findServerLock(hashset *serverLocks, pthread_mutex_t *dataLock, const char* serverURL);
+static sem_t* findServerLock(hashset *serverLocks, pthread_mutex_t *dataLock, internedStrings *strings, const char* serverURL);
 
 /**
  * Function: main
@@ -151,10 +182,11 @@ int main(int argc, char **argv)
   rssDatabase db;
     
   initThreadsData(&db);
+  InternedStringsNew(&db.strings);
   //InitThreadPackage(false);
   
   Welcome(kWelcomeTextFile);
-  LoadStopWords(&db.stopWords, kDefaultStopWordsFile);
+  LoadStopWords(&db.stopWords, &db.strings, kDefaultStopWordsFile);
   
   
   BuildIndices(&db, feedsFileName);
@@ -197,7 +229,7 @@ static void Welcome(const char *welcomeTextURL)
   } else {
     streamtokenizer st;
     char buffer[4096];
-    STNew(&st, urlconn.dataStream, kNewLineDelimiters, true);
+    STNewBuffered(&st, urlconn.dataStream, kNewLineDelimiters, true);
     while (STNextToken(&st, buffer, sizeof(buffer))) {
       printf("%s\n", buffer);
     }  
@@ -232,7 +264,7 @@ static void Welcome(const char *welcomeTextURL)
  */
 
 static const int kNumStopWordsBuckets = 1009;
-static void LoadStopWords(hashset *stopWords, const char *stopWordsURL)
+static void LoadStopWords(hashset *stopWords, internedStrings *strings, const char *stopWordsURL)
 {
   url u;
   urlconnection urlconn;
@@ -241,14 +273,14 @@ static void LoadStopWords(hashset *stopWords, const char *stopWordsURL)
   URLConnectionNew(&urlconn, &u);
   
   if (urlconn.responseCode / 100 == 3) {
-    LoadStopWords(stopWords, urlconn.newUrl);
+    LoadStopWords(stopWords, strings, urlconn.newUrl);
   } else {
     streamtokenizer st;
     char buffer[4096];
-    HashSetNew(stopWords, sizeof(char *), kNumStopWordsBuckets, StringHash, StringCompare, StringFree);
-    STNew(&st, urlconn.dataStream, kNewLineDelimiters, true);
+    HashSetNew(stopWords, sizeof(char *), kNumStopWordsBuckets, StringHash, StringCompare, NULL);
+    STNewBuffered(&st, urlconn.dataStream, kNewLineDelimiters, true);
     while (STNextToken(&st, buffer, sizeof(buffer))) {
-      char *stopWord = strdup(buffer);
+      const char *stopWord = InternString(strings, buffer);
       HashSetEnter(stopWords, &stopWord);
     }
     STDispose(&st);
@@ -282,6 +314,7 @@ static void LoadStopWords(hashset *stopWords, const char *stopWordsURL)
 
 
 static const int kNumIndexEntryBuckets = 10007;
+static const int kNumIndexEntryShards = 64;
 static void BuildIndices(rssDatabase *db, const char *feedsFileURL)
 {
   url u;
@@ -294,10 +327,11 @@ static void BuildIndices(rssDatabase *db, const char *feedsFileURL)
   } else {
     streamtokenizer st;
     char remoteFileName[2048];
-    HashSetNew(&db->indices, sizeof(rssIndexEntry), kNumIndexEntryBuckets, IndexEntryHash, IndexEntryCompare, IndexEntryFree);
-    VectorNew(&db->previouslySeenArticles, sizeof(rssNewsArticle), NewsArticleFree, 0);
+    ConcurrentHashSetNew(&db->indices, sizeof(rssIndexEntry), kNumIndexEntryBuckets, kNumIndexEntryShards,
+			 IndexEntryHash, IndexEntryCompare, IndexEntryFree);
+    VectorNew(&db->previouslySeenArticles, sizeof(rssNewsArticle), NULL, 0); // strings are interned
   
-    STNew(&st, urlconn.dataStream, kNewLineDelimiters, true);
+    STNewBuffered(&st, urlconn.dataStream, kNewLineDelimiters, true);
     while (STSkipUntil(&st, ":") != EOF) { // ignore everything up to the first selicolon of the line
       STSkipOver(&st, ": ");		   // now ignore the semicolon and any whitespace directly after it
       STNextToken(&st, remoteFileName, sizeof(remoteFileName));
@@ -376,6 +410,10 @@ static void ProcessFeed(rssDatabase *db, const char *remoteDocumentName)
  *
  * We're only interested in the title and link tags.
  *
+ * The feed is handed to expat in large blocks, read straight into expat's own
+ * buffer.  Expat doesn't care where lines (or anything else) begin and end, so
+ * there's no reason to tokenize the feed first.
+ *
  * @param db the address of the rssDatabase housing the three respositories
  *           of information: the stop words set, the set of previously indexed articles,
  *           and the set of indices.
@@ -383,24 +421,24 @@ static void ProcessFeed(rssDatabase *db, const char *remoteDocumentName)
  *                connection to the class.
  */
 
+static const int kFeedBlockSize = 1 << 16;
 static void PullAllNewsItems(rssDatabase *db, urlconnection *urlconn)
 {
   rssFeedState state = {db}; // passed through the parser by address as auxiliary data.
-  streamtokenizer st;
-  char buffer[2048];
 
   XML_Parser rssFeedParser = XML_ParserCreate(NULL);
   XML_SetUserData(rssFeedParser, &state);
   XML_SetElementHandler(rssFeedParser, ProcessStartTag, ProcessEndTag);
   XML_SetCharacterDataHandler(rssFeedParser, ProcessTextData);
 
-  STNew(&st, urlconn->dataStream, "\n", false);
-  while (STNextToken(&st, buffer, sizeof(buffer))) {
-    XML_Parse(rssFeedParser, buffer, strlen(buffer), false);
+  while (true) {
+    void *block = XML_GetBuffer(rssFeedParser, kFeedBlockSize);
+    assert(block != NULL);
+    int numRead = fread(block, 1, kFeedBlockSize, urlconn->dataStream);
+    XML_ParseBuffer(rssFeedParser, numRead, numRead == 0); // an empty final block tells expat we're done
+    if (numRead == 0) break;
   }
-  STDispose(&st);
   
-  XML_Parse(rssFeedParser, "", 0, true); // instructs the xml parser that we're done parsing..
   XML_ParserFree(rssFeedParser);  
 }
 
@@ -513,8 +551,8 @@ static void NewThreadParseArticle(rssDatabase *db, const char *articleTitle, con
   threadData newThreadData;  
   newThreadData.arg = malloc(sizeof(threadArguments));
   newThreadData.arg->db = db;
-  newThreadData.arg->title = strdup(articleTitle);
-  newThreadData.arg->URL = strdup(articleURL);
+  newThreadData.arg->title = InternString(&db->strings, articleTitle);
+  newThreadData.arg->URL = InternString(&db->strings, articleURL);
   
   int tID = VectorLength(&db->threads);
   
@@ -601,15 +639,15 @@ static void ParseArticle(rssDatabase *db, const char *articleTitle, const char *
       case 200: //printf("[%s] Ready to Index \"%s\"\n", u.serverName, articleTitle);
 	      pthread_mutex_lock(articlesLock);
 	      printf("[%s] Indexing \"%s\"\n", u.serverName, articleTitle);
-	      NewsArticleClone(&newsArticle, articleTitle, u.serverName, u.fullName);
+	      NewsArticleClone(&newsArticle, &db->strings, articleTitle, u.serverName, u.fullName);
 	      
 	      VectorAppend(&db->previouslySeenArticles, &newsArticle);
 	      articleID = VectorLength(&db->previouslySeenArticles) - 1;
 	      pthread_mutex_unlock(articlesLock);
 
-	      STNew(&st, urlconn.dataStream, kTextDelimiters, false);	
+	      STNewBuffered(&st, urlconn.dataStream, kTextDelimiters, false);	
 	      ScanArticle(&st, articleID, &db->indices, &db->stopWords,
-			  &(db->locks.indicesHashSetLock),&(db->locks.stopWordsHashSetLock) );
+			  &(db->locks.stopWordsHashSetLock), &db->strings);
 	      
 	      
 	    
@@ -644,19 +682,38 @@ static void ParseArticle(rssDatabase *db, const char *articleTitle, const char *
  * Pulls all of the content from the document via the addressed tokenizer.  Each word
  * that's deemed interesting enough to catalog is added to the specified set of indices.
  *
+ * Words are first tallied in a hashset private to this article, and only once the
+ * article has been fully read does each distinct word get added to the shared
+ * indices, along with the number of times it occurred.  That cuts the trips into
+ * the shared indices (and the contention with other article threads) down to one
+ * per distinct word.  The private hashset, and every copy of a word it holds,
+ * lives in an arena of its own, so none of it touches the shared heap, and all of
+ * it goes away at once when the arena is disposed of.
+ *
  * @param st the address of the streamtokenzer layering over the urlconnection to some online
  *           news article.
  * @param articleID the index of the relevant article within the vector of previously parsed articles.
  * @param indices the set of indices to which all content in the article being parsed should be added.
+ *                It's thread-safe, so articles being scanned by other threads can add to it at the same time.
  * @param stopWords the set of stop words.
+ * @param strings the pool that newly indexed words are interned into.
  *
  * No return value.
  */
 
-static void ScanArticle(streamtokenizer *st, int articleID, hashset *indices, hashset *stopWords, pthread_mutex_t* indicesLock, pthread_mutex_t* stopWordsLock)
+static const int kNumArticleWordBuckets = 1023;
+static void ScanArticle(streamtokenizer *st, int articleID, concurrenthashset *indices, hashset *stopWords, pthread_mutex_t* stopWordsLock,
+			internedStrings *strings)
 {
   char word[1024];
-
+  arena articleMemory;
+  allocator articleAllocator;
+  hashset tallies;
+
+  ArenaNew(&articleMemory, 0);
+  ArenaAllocatorNew(&articleAllocator, &articleMemory);
+  HashSetNewUsingAllocator(&tallies, sizeof(wordTally), kNumArticleWordBuckets,
+			   StringHash, StringCompare, NULL, kHashSetOpenAddressing, &articleAllocator);
   while (STNextToken(st, word, sizeof(word))) {
     if (strcasecmp(word, "<") == 0) {
       SkipIrrelevantContent(st);
@@ -665,15 +722,53 @@ static void ScanArticle(streamtokenizer *st, int articleID, hashset *indices, ha
       pthread_mutex_lock(stopWordsLock);
       bool startIndexNow = WordIsWorthIndexing(word, stopWords);
       pthread_mutex_unlock(stopWordsLock);
-      if (startIndexNow){
-	
-	pthread_mutex_lock(indicesLock);
-	AddWordToIndices(indices, word, articleID);
-	//printf("DONE INDEXING");
-	pthread_mutex_unlock(indicesLock);
-      }
+      if (startIndexNow)
+	TallyWord(&tallies, &articleMemory, word);
     }
   }
+
+  articleTallies flush = { indices, strings, articleID };
+  HashSetMap(&tallies, FlushWordTally, &flush);
+  HashSetDispose(&tallies);     // releases nothing, since the arena owns all of the hashset's memory
+  ArenaDispose(&articleMemory); // this is what actually reclaims the tallies and the word copies
+}
+
+/**
+ * Bumps the article-private frequency count of the specified word, copying
+ * the word into the article's arena the first time it's seen.
+ *
+ * @param tallies the hashset of wordTally records for the article being scanned.
+ * @param articleMemory the arena backing the tallies.
+ * @param word the word being tallied, which lives in the caller's buffer.
+ *
+ * No return value.
+ */
+
+static void TallyWord(hashset *tallies, arena *articleMemory, const char *word)
+{
+  wordTally probe = { word, 0 };
+  bool inserted;
+  wordTally *tally = HashSetFindOrInsert(tallies, &probe, &inserted);
+  if (inserted) tally->word = ArenaStrdup(articleMemory, word);
+  tally->freq++;
+}
+
+/**
+ * Map function handed to HashSetMap once an article has been fully scanned.
+ * Adds one of the article's words to the shared indices, along with the
+ * number of times it occurred in the article.
+ *
+ * @param elem the address of a wordTally.
+ * @param auxData the address of the articleTallies identifying the article.
+ *
+ * No return value.
+ */
+
+static void FlushWordTally(void *elem, void *auxData)
+{
+  const wordTally *tally = elem;
+  const articleTallies *article = auxData;
+  AddWordToIndices(article->indices, article->strings, tally->word, article->articleIndex, tally->freq);
 }
 
 /**
@@ -703,25 +798,49 @@ static bool WordIsWorthIndexing(const char *word, hashset *stopWords)
 /**
  * Adds the specified word (already deemed to be worth indexing)
  * to the set of indices, attaching it to the specified articleID (from
- * which the actual article can be easily recovered.)
+ * which the actual article can be easily recovered.)  The lookup, the
+ * insertion of a brand new index entry, and the frequency update all
+ * happen as one atomic step, courtesy of ConcurrentHashSetFindOrInsert,
+ * so no lock needs to be held around the call.
  *
  * @param indices the set of indices being built.
+ * @param strings the pool the word is interned into if it's new to the indices.
  * @param word the word being added to the set of indices.
  * @param articleIndex the index of the relevant article where the word was found.
+ * @param freq the number of times the word occurs in the article.
  *
  * No return value.
  */
 
-static void AddWordToIndices(hashset *indices, const char *word, int articleIndex)
+static void AddWordToIndices(concurrenthashset *indices, internedStrings *strings, const char *word,
+			     int articleIndex, int freq)
 {
   rssIndexEntry indexEntry = { word }; // partial intialization
-  rssIndexEntry *existingIndexEntry = HashSetLookup(indices, &indexEntry);
-  if (existingIndexEntry == NULL) {
-    indexEntry.meaningfulWord = strdup(word);
-    VectorNew(&indexEntry.relevantArticles, sizeof(rssRelevantArticleEntry), NULL, 0);
-    HashSetEnter(indices, &indexEntry);
-    existingIndexEntry = HashSetLookup(indices, &indexEntry); // pretend like it's been there all along
-    assert(existingIndexEntry != NULL);
+  wordOccurrence occurrence = { strings, articleIndex, freq };
+  ConcurrentHashSetFindOrInsert(indices, &indexEntry, RecordWordOccurrence, &occurrence);
+}
+
+/**
+ * Update function handed to ConcurrentHashSetFindOrInsert by AddWordToIndices.
+ * A freshly inserted index entry still refers to the caller's copy of the word,
+ * so it gets the interned copy and an empty list of articles before the article's
+ * frequency count is bumped by the number of times the word occurred in it.
+ *
+ * @param elem the address of the rssIndexEntry stored in the set of indices.
+ * @param inserted true if and only if the entry was just inserted.
+ * @param auxData the address of a wordOccurrence identifying the relevant article.
+ *
+ * No return value.
+ */
+
+static void RecordWordOccurrence(void *elem, bool inserted, void *auxData)
+{
+  rssIndexEntry *existingIndexEntry = elem;
+  wordOccurrence *occurrence = auxData;
+  int articleIndex = occurrence->articleIndex;
+  if (inserted) {
+    existingIndexEntry->meaningfulWord = InternString(occurrence->strings, existingIndexEntry->meaningfulWord);
+    VectorNew(&existingIndexEntry->relevantArticles, sizeof(rssRelevantArticleEntry), NULL, 0);
   }
 
   rssRelevantArticleEntry articleEntry = { articleIndex, 0 };
@@ -734,7 +853,7 @@ static void AddWordToIndices(hashset *indices, const char *word, int articleInde
   
   rssRelevantArticleEntry *existingArticleEntry = 
     VectorNth(&existingIndexEntry->relevantArticles, existingArticleIndex);
-  existingArticleEntry->freq++;
+  existingArticleEntry->freq += occurrence->freq;
 }
 
 /** 
@@ -761,9 +880,10 @@ static void QueryIndices(rssDatabase *db)
     ProcessResponse(db, response);
   }
   
-  HashSetDispose(&db->indices);
+  ConcurrentHashSetDispose(&db->indices);
   VectorDispose(&db->previouslySeenArticles); 
   HashSetDispose(&db->stopWords);
+  InternedStringsDispose(&db->strings); // every word, title, and URL, all at once
 }
 
 /** 
@@ -792,7 +912,7 @@ static void ProcessResponse(rssDatabase *db, const char *word)
   }
 
   rssIndexEntry entry = { word };
-  rssIndexEntry *existingIndex = HashSetLookup(&db->indices, &entry);
+  rssIndexEntry *existingIndex = ConcurrentHashSetLookup(&db->indices, &entry);
   if (existingIndex == NULL) {
     printf("None of today's news articles contain the word \"%s\".\n\n", word);
     return;
@@ -891,7 +1011,7 @@ static int StringHash(const void *elem, int numBuckets)
   unsigned long hashcode = 0;
   const char *s = *(const char **) elem;
 
-  for (int i = 0; i < strlen(s); i++)
+  for (int i = 0; s[i] != '\0'; i++)
     hashcode = hashcode * kHashMultiplier + tolower(s[i]);  
   
   return hashcode % numBuckets;                                
@@ -919,37 +1039,63 @@ static int StringCompare(const void *elem1, const void *elem2)
 {
   const char *s1 = *(const char **) elem1;
   const char *s2 = *(const char **) elem2;
+  if (s1 == s2) return 0; // two interned copies of the same string
   return strcasecmp(s1, s2);
 }
 
 /**
- * Function: StringFree
- * --------------------
- * Disposes of the char * address by the supplied void *.
- * The char *s point to dyanamically allocated character arrays
- * generated by strdup, so we rely on the stdlib free function
- * to donate the memory back to the heap. (strdup uses malloc)
- *
- * @param the address of the dynamically allocated string to be
- *        freed.
+ * Function: InternedStringsNew, InternedStringsDispose
+ * ----------------------------------------------------
+ * Set up and tear down the pool of interned strings.  Disposing of
+ * the pool releases every string ever interned, all in one go, so none
+ * of the data structures that refer to interned strings need to free
+ * them individually.
+ */
+
+static const int kNumInternedStringsBuckets = 10007;
+static void InternedStringsNew(internedStrings *strings)
+{
+  StringPoolNew(&strings->pool, kNumInternedStringsBuckets);
+  pthread_mutex_init(&strings->lock, NULL);
+}
+
+static void InternedStringsDispose(internedStrings *strings)
+{
+  pthread_mutex_destroy(&strings->lock);
+  StringPoolDispose(&strings->pool);
+}
+
+/**
+ * Function: InternString
+ * ----------------------
+ * Thread-safe wrapper around StringPoolIntern.  The pool's lock is
+ * never held while any other lock is acquired, so it's safe to call
+ * this while holding an article, stop word, or shard lock.
  *
- * No return value to speak of.
+ * @param strings the pool of interned strings.
+ * @param s the string to be interned.
+ * @return the address of the canonical copy of s, which lives until
+ *         the pool is disposed of.
  */
 
-static void StringFree(void *elem)
+static const char *InternString(internedStrings *strings, const char *s)
 {
-  free(*(char **)elem);
+  pthread_mutex_lock(&strings->lock);
+  const char *canonical = StringPoolIntern(&strings->pool, s);
+  pthread_mutex_unlock(&strings->lock);
+  return canonical;
 }
 
 /**
  * Function: NewsArticleClone
  * --------------------------
- * Utility function that inserts deep copies of the three C strings and
- * embeds them in the three corresponding fields of the rssNewsArticle.
- * It assumes the contents of the rssNewsArticle can be safely overwritten
- * without orphaning memory.
+ * Utility function that interns the three C strings and embeds the
+ * canonical copies in the three corresponding fields of the rssNewsArticle.
+ * The copies belong to the pool of interned strings, so the rssNewsArticle
+ * never needs to be freed.
  *
  * @param article the address of the rssNewsArticle to be populated
+ * @param strings the pool the three strings are interned into.
  * @param title the title string that should be planted into the clone.
  * @param server the server string that should be planted into the clone.
  * @param fullURL the url string that should be planted into the clone.
@@ -959,12 +1105,12 @@ static void StringFree(void *elem)
  * return (and copy) and entire struct by value.
  */
 
-static void NewsArticleClone(rssNewsArticle *article, const char *title, 
+static void NewsArticleClone(rssNewsArticle *article, internedStrings *strings, const char *title, 
 			     const char *server, const char *fullURL)
 {
-  article->title = strdup(title);
-  article->server = strdup(server);
-  article->fullURL = strdup(fullURL);
+  article->title = InternString(strings, title);
+  article->server = InternString(strings, server);
+  article->fullURL = InternString(strings, fullURL);
 }
 
 /**
@@ -993,28 +1139,6 @@ static int NewsArticleCompare(const void *elem1, const void *elem2)
   return StringCompare(&article1->fullURL, &article2->fullURL);
 }
 
-/**
- * Function: NewsArticleFree
- * -------------------------
- * Diposes of the three dynamically allocated C strings
- * held by the rssNewsArticle addressed by elem.  We
- * rely on the services to the StringFree function
- * to the freeing.
- *
- * @param elem the address of the rssNewsArticle being disposed of.
- *
- * No return value.  Note that the rssNewsArticle addressed by elem is
- * invalidated after this function returns.
- */
-
-static void NewsArticleFree(void *elem)
-{
-  rssNewsArticle *article = elem;
-  StringFree(&article->title);
-  StringFree(&article->server);
-  StringFree(&article->fullURL);
-}
-
 /**
  * Function: IndexEntryHash
  * ------------------------
@@ -1060,14 +1184,13 @@ static int IndexEntryCompare(const void *elem1, const void *elem2)
 /**
  * Function: IndexEntryFree
  * ------------------------
- * Disposes of all resources held by the rssIndexEntry.
- * Self-explanatory implementation.
+ * Disposes of all resources held by the rssIndexEntry.  The
+ * meaningful word is interned, so it's left for the pool to free.
  */
 
 static void IndexEntryFree(void *elem)
 {
   rssIndexEntry *entry = elem;
-  StringFree(&entry->meaningfulWord);
   VectorDispose(&entry->relevantArticles);
 }
 
@@ -1089,10 +1212,7 @@ static int ArticleFrequencyCompare(const void *elem1, const void *elem2)
 static void ThreadDataFree(void *elem){
   threadData* data = elem;
   pthread_join(data->threadID,NULL);
-  threadArguments* arg =data->arg;
-  StringFree(&arg->title);
-  StringFree(&arg->URL);
-  free(data->arg);
+  free(data->arg); // title and URL are interned
 }
 
 static int ConnectionsLockHash(const void* elemAddr, int numBuckets){
@@ -1107,7 +1227,6 @@ static int ConnectionsLockCompare(const void* elemAddr1, const void* elemAddr2){
 }
 static void ConnectionsLockFree(void* elemAddr){
   serverLockData * data = elemAddr;
-  StringFree(&data->url);
   sem_destroy(data->serverLock);
   free(data->serverLock);
 }
@@ -1124,7 +1243,6 @@ static void initThreadsData(rssDatabase *db)
   
   pthread_mutex_init(&(db->locks.serverDataLock), NULL);  
   pthread_mutex_init(&(db->locks.articlesVectorLock), NULL);
-  pthread_mutex_init(&(db->locks.indicesHashSetLock), NULL);
   pthread_mutex_init(&(db->locks.stopWordsHashSetLock), NULL);
   sem_init(&(db->locks.connectionsLock),0,kNumOfConnections);
   
@@ -1136,28 +1254,25 @@ static void cleanThreadData(rssDatabase *db)
 
   pthread_mutex_destroy(&(db->locks.serverDataLock));  
   pthread_mutex_destroy(&(db->locks.articlesVectorLock));
-  pthread_mutex_destroy(&(db->locks.indicesHashSetLock));
   pthread_mutex_destroy(&(db->locks.stopWordsHashSetLock));
   sem_destroy(&(db->locks.connectionsLock));
   
 }
 static const int kSimultaneousServerConn = 6;
-static sem_t* findServerLock(hashset *serverLocks, pthread_mutex_t *dataLock, const char* serverURL){
+static sem_t* findServerLock(hashset *serverLocks, pthread_mutex_t *dataLock, internedStrings *strings, const char* serverURL){
  
   pthread_mutex_lock(dataLock);
   sem_t * serverLock;
   serverLockData newLockData = {serverURL}; 
-  serverLockData* lockDataP = HashSetLookup(serverLocks, &newLockData);
+  bool inserted;
+  serverLockData* lockDataP = HashSetFindOrInsert(serverLocks, &newLockData, &inserted);
   
-  if(lockDataP==NULL){
-
-    newLockData.url = strdup(serverURL);
-    newLockData.serverLock = malloc(sizeof(sem_t));
-    sem_init(newLockData.serverLock,0,kSimultaneousServerConn);
-
-    HashSetEnter(serverLocks, &newLockData);
-    lockDataP = HashSetLookup(serverLocks, &newLockData);
-    //create semaphore
+  if(inserted){
+    // the stored copy still points to the caller's url, so give it the interned one,
+    // and create the semaphore in place
+    lockDataP->url = InternString(strings, serverURL);
+    lockDataP->serverLock = malloc(sizeof(sem_t));
+    sem_init(lockDataP->serverLock,0,kSimultaneousServerConn);
   }
   serverLock = lockDataP->serverLock;
   
@@ -1166,14 +1281,14 @@ static sem_t* findServerLock(hashset *serverLocks, pthread_mutex_t *dataLock, co
 }
 static void lockConnection(rssDatabase *db, const char* serverURL){
   sem_t *conCounter = &(db->locks.connectionsLock);
-  sem_t *serverLock =  findServerLock(&(db->locks.limitConnToServerLock),&(db->locks.serverDataLock),serverURL);
+  sem_t *serverLock =  findServerLock(&(db->locks.limitConnToServerLock),&(db->locks.serverDataLock),&db->strings,serverURL);
   sem_wait(conCounter);
   sem_wait(serverLock);
 }
 
 static void unlockConnection(rssDatabase *db, const char* serverURL){
   sem_t *conCounter = &(db->locks.connectionsLock);  
-  sem_t *serverLock =  findServerLock(&(db->locks.limitConnToServerLock),&(db->locks.serverDataLock),serverURL);
+  sem_t *serverLock =  findServerLock(&(db->locks.limitConnToServerLock),&(db->locks.serverDataLock),&db->strings,serverURL);
   sem_post(conCounter);  
   sem_post(serverLock);
 }